@@ -0,0 +1,137 @@
+/**
+ * fxmath.c - Fixed-point multiply and trig helpers
+ *
+ * The SM83 has no multiply instruction and SDCC expands every
+ * (int32_t)a * b into its generic 32-bit multiply routine. Here products
+ * are built from a ROM table of quarter squares instead:
+ *
+ *     x * y = floor((x + y)^2 / 4) - floor((x - y)^2 / 4)
+ *
+ * which is exact for all integers (x + y and x - y have the same parity).
+ * Wider products are assembled from byte products.
+ */
+
+#include <stdint.h>
+#include "fxmath.h"
+#include "profile.h"
+
+/*============================================================================
+ * QUARTER-SQUARE TABLE: fx_sq4[n] = floor(n^2 / 4), n = 0..511
+ * Covers |x + y| and |x - y| for any signed/unsigned byte operand pair.
+ *============================================================================*/
+
+static const uint16_t fx_sq4[512] = {
+        0,     0,     1,     2,     4,     6,     9,    12,    16,    20,    25,    30,
+       36,    42,    49,    56,    64,    72,    81,    90,   100,   110,   121,   132,
+      144,   156,   169,   182,   196,   210,   225,   240,   256,   272,   289,   306,
+      324,   342,   361,   380,   400,   420,   441,   462,   484,   506,   529,   552,
+      576,   600,   625,   650,   676,   702,   729,   756,   784,   812,   841,   870,
+      900,   930,   961,   992,  1024,  1056,  1089,  1122,  1156,  1190,  1225,  1260,
+     1296,  1332,  1369,  1406,  1444,  1482,  1521,  1560,  1600,  1640,  1681,  1722,
+     1764,  1806,  1849,  1892,  1936,  1980,  2025,  2070,  2116,  2162,  2209,  2256,
+     2304,  2352,  2401,  2450,  2500,  2550,  2601,  2652,  2704,  2756,  2809,  2862,
+     2916,  2970,  3025,  3080,  3136,  3192,  3249,  3306,  3364,  3422,  3481,  3540,
+     3600,  3660,  3721,  3782,  3844,  3906,  3969,  4032,  4096,  4160,  4225,  4290,
+     4356,  4422,  4489,  4556,  4624,  4692,  4761,  4830,  4900,  4970,  5041,  5112,
+     5184,  5256,  5329,  5402,  5476,  5550,  5625,  5700,  5776,  5852,  5929,  6006,
+     6084,  6162,  6241,  6320,  6400,  6480,  6561,  6642,  6724,  6806,  6889,  6972,
+     7056,  7140,  7225,  7310,  7396,  7482,  7569,  7656,  7744,  7832,  7921,  8010,
+     8100,  8190,  8281,  8372,  8464,  8556,  8649,  8742,  8836,  8930,  9025,  9120,
+     9216,  9312,  9409,  9506,  9604,  9702,  9801,  9900, 10000, 10100, 10201, 10302,
+    10404, 10506, 10609, 10712, 10816, 10920, 11025, 11130, 11236, 11342, 11449, 11556,
+    11664, 11772, 11881, 11990, 12100, 12210, 12321, 12432, 12544, 12656, 12769, 12882,
+    12996, 13110, 13225, 13340, 13456, 13572, 13689, 13806, 13924, 14042, 14161, 14280,
+    14400, 14520, 14641, 14762, 14884, 15006, 15129, 15252, 15376, 15500, 15625, 15750,
+    15876, 16002, 16129, 16256, 16384, 16512, 16641, 16770, 16900, 17030, 17161, 17292,
+    17424, 17556, 17689, 17822, 17956, 18090, 18225, 18360, 18496, 18632, 18769, 18906,
+    19044, 19182, 19321, 19460, 19600, 19740, 19881, 20022, 20164, 20306, 20449, 20592,
+    20736, 20880, 21025, 21170, 21316, 21462, 21609, 21756, 21904, 22052, 22201, 22350,
+    22500, 22650, 22801, 22952, 23104, 23256, 23409, 23562, 23716, 23870, 24025, 24180,
+    24336, 24492, 24649, 24806, 24964, 25122, 25281, 25440, 25600, 25760, 25921, 26082,
+    26244, 26406, 26569, 26732, 26896, 27060, 27225, 27390, 27556, 27722, 27889, 28056,
+    28224, 28392, 28561, 28730, 28900, 29070, 29241, 29412, 29584, 29756, 29929, 30102,
+    30276, 30450, 30625, 30800, 30976, 31152, 31329, 31506, 31684, 31862, 32041, 32220,
+    32400, 32580, 32761, 32942, 33124, 33306, 33489, 33672, 33856, 34040, 34225, 34410,
+    34596, 34782, 34969, 35156, 35344, 35532, 35721, 35910, 36100, 36290, 36481, 36672,
+    36864, 37056, 37249, 37442, 37636, 37830, 38025, 38220, 38416, 38612, 38809, 39006,
+    39204, 39402, 39601, 39800, 40000, 40200, 40401, 40602, 40804, 41006, 41209, 41412,
+    41616, 41820, 42025, 42230, 42436, 42642, 42849, 43056, 43264, 43472, 43681, 43890,
+    44100, 44310, 44521, 44732, 44944, 45156, 45369, 45582, 45796, 46010, 46225, 46440,
+    46656, 46872, 47089, 47306, 47524, 47742, 47961, 48180, 48400, 48620, 48841, 49062,
+    49284, 49506, 49729, 49952, 50176, 50400, 50625, 50850, 51076, 51302, 51529, 51756,
+    51984, 52212, 52441, 52670, 52900, 53130, 53361, 53592, 53824, 54056, 54289, 54522,
+    54756, 54990, 55225, 55460, 55696, 55932, 56169, 56406, 56644, 56882, 57121, 57360,
+    57600, 57840, 58081, 58322, 58564, 58806, 59049, 59292, 59536, 59780, 60025, 60270,
+    60516, 60762, 61009, 61256, 61504, 61752, 62001, 62250, 62500, 62750, 63001, 63252,
+    63504, 63756, 64009, 64262, 64516, 64770, 65025, 65280
+};
+
+/* x * y modulo 2^16 for -256 <= x, y <= 255 (the caller picks the sign) */
+static uint16_t qs_mul(int16_t x, int16_t y) {
+    int16_t sum = x + y;
+    int16_t diff = x - y;
+    
+    if (sum < 0) sum = -sum;
+    if (diff < 0) diff = -diff;
+    return (uint16_t)(fx_sq4[sum] - fx_sq4[diff]);
+}
+
+/*============================================================================
+ * MULTIPLY ROUTINES
+ *============================================================================*/
+
+int16_t fx_mul8x8(int8_t a, int8_t b) {
+    COUNT_OP(OP_MUL);
+    return (int16_t)qs_mul(a, b);
+}
+
+int32_t fx_mul16x8(int16_t a, int8_t b) {
+    COUNT_OP(OP_MUL);
+    
+    /* a = hi * 256 + lo with hi signed, lo unsigned */
+    int8_t hi = (int8_t)(a >> 8);
+    uint8_t lo = (uint8_t)a;
+    
+    return ((int32_t)(int16_t)qs_mul(hi, b) << 8) + (int16_t)qs_mul(lo, b);
+}
+
+int32_t fx_mul16x16(int16_t a, int16_t b) {
+    COUNT_OP(OP_MUL);
+    
+    int8_t a_hi = (int8_t)(a >> 8);
+    int8_t b_hi = (int8_t)(b >> 8);
+    uint8_t a_lo = (uint8_t)a;
+    uint8_t b_lo = (uint8_t)b;
+    
+    int32_t mid = (int32_t)(int16_t)qs_mul(a_hi, b_lo) + (int16_t)qs_mul(a_lo, b_hi);
+    
+    return ((int32_t)(int16_t)qs_mul(a_hi, b_hi) << 16) + (mid << 8) + qs_mul(a_lo, b_lo);
+}
+
+/*============================================================================
+ * TRIG: 256 steps per turn, 8.8 results
+ * Quarter-wave table, fx_sin_table[i] = round(256 * sin(i * 2pi / 256))
+ *============================================================================*/
+
+static const int16_t fx_sin_table[65] = {
+      0,   6,  13,  19,  25,  31,  38,  44,  50,  56,  62,  68,  74,
+     80,  86,  92,  98, 104, 109, 115, 121, 126, 132, 137, 142, 147,
+    152, 157, 162, 167, 172, 177, 181, 185, 190, 194, 198, 202, 206,
+    209, 213, 216, 220, 223, 226, 229, 231, 234, 237, 239, 241, 243,
+    245, 247, 248, 250, 251, 252, 253, 254, 255, 255, 256, 256, 256
+};
+
+fixed8_t fx_sin(uint8_t angle) {
+    uint8_t step = angle & 63;
+    
+    switch (angle >> 6) {
+        case 0:  return fx_sin_table[step];
+        case 1:  return fx_sin_table[64 - step];
+        case 2:  return -fx_sin_table[step];
+        default: return -fx_sin_table[64 - step];
+    }
+}
+
+fixed8_t fx_cos(uint8_t angle) {
+    return fx_sin((uint8_t)(angle + 64));
+}
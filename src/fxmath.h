@@ -0,0 +1,40 @@
+/**
+ * fxmath.h - Fixed-point math (8.8 format, quarter-square multiply, trig)
+ */
+
+#ifndef _FXMATH_H
+#define _FXMATH_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * FIXED-POINT MATH (8.8 format)
+ *============================================================================*/
+
+typedef int16_t fixed8_t;
+
+#define FX8_SHIFT       8
+#define FX8_ONE         (1 << FX8_SHIFT)
+#define FX8_HALF        (FX8_ONE >> 1)
+
+#define INT_TO_FX8(x)   ((fixed8_t)((x) << FX8_SHIFT))
+#define FX8_TO_INT(x)   ((int8_t)((x) >> FX8_SHIFT))
+#define FX8_MUL(a, b)   ((fixed8_t)(fx_mul16x16((a), (b)) >> FX8_SHIFT))
+
+/*============================================================================
+ * MULTIPLY (quarter-square table in ROM, no compiler multiply helper)
+ *============================================================================*/
+
+/* Exact signed products */
+int16_t fx_mul8x8(int8_t a, int8_t b);
+int32_t fx_mul16x8(int16_t a, int8_t b);
+int32_t fx_mul16x16(int16_t a, int16_t b);
+
+/*============================================================================
+ * TRIG (angle: 256 steps per turn, result 8.8)
+ *============================================================================*/
+
+fixed8_t fx_sin(uint8_t angle);
+fixed8_t fx_cos(uint8_t angle);
+
+#endif
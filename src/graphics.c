@@ -44,10 +44,11 @@ void setup_palette_attributes(void) {
         set_bkg_tiles(0, y, 32, 1, border_attr);
     }
     
-    /* Render area uses palette 0 */
+    /* Render area uses palette 0, and a full screen's lower rows VRAM bank 1
+     * (see RENDER_BANK_ROWS) */
     uint8_t render_attr[RENDER_TILES_X];
-    memset(render_attr, 0, RENDER_TILES_X);
     for (uint8_t y = 0; y < RENDER_TILES_Y; y++) {
+        memset(render_attr, RENDER_ROW_BANK(y) ? BKGF_BANK1 : 0, RENDER_TILES_X);
         set_bkg_tiles(map_offset_x, map_offset_y + y, RENDER_TILES_X, 1, render_attr);
     }
     
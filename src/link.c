@@ -0,0 +1,454 @@
+/**
+ * link.c - Rendering partner over the link cable (make LINK_CABLE=ON)
+ *
+ * Only built with LINK_CABLE (see Makefile). The master drives the serial
+ * clock at the CGB's fast speed (a byte in 128 clocks). While a packet is
+ * in flight either way, its serial interrupt clocks the next byte as soon
+ * as the last one is in; between packets it polls one byte per VBlank.
+ * The slave only ever answers, from its serial interrupt: that handler
+ * loads the byte it prepared the time before, then reads the master's,
+ * while the master's reads first and clocks last, so the slave's byte is
+ * always in place first. Up to LINK_JOBS jobs are with the slave, so it
+ * has the next row to trace when it sends one back.
+ */
+
+#include <gb/gb.h>
+#include <gb/cgb.h>
+#include <string.h>
+#include "link.h"
+#include "luts.h"
+
+/*============================================================================
+ * PACKETS
+ * LINK_SYNC, type, header, data, then two 8-bit sums of everything after
+ * LINK_SYNC: of the bytes, and of the first sum after each byte (so two
+ * errors that cancel in the first rarely do in both). Between packets the
+ * slave sends its state (LINK_IDLE / LINK_BUSY); with no cable the master
+ * reads 0xFF.
+ *============================================================================*/
+
+#define LINK_SYNC   0xA5
+#define LINK_IDLE   0x00
+#define LINK_BUSY   0x01
+
+#define PACKET_HELLO  0x10   /* Master: version, scene_hash */
+#define PACKET_ACK    0x11   /* Slave: the same back */
+#define PACKET_JOB    0x20   /* Master: view, tile row */
+#define PACKET_ROW    0x21   /* Slave: view, tile row, length (low, high), packed row */
+
+#define HELLO_SIZE    5
+#define HEADER_MAX    5
+
+/* Builds that trace different tiles must not pair: scene_hash covers the
+ * scene and its tables, the version the dither pattern */
+#ifdef DITHER_4X4
+#define LINK_VERSION  0x82
+#else
+#define LINK_VERSION  0x02
+#endif
+
+#define HELLO_FRAMES  30    /* Frames between probes for a partner */
+#define LOST_POLLS    60    /* Bytes in a row that are no slave state: the partner is gone */
+#define IDLE_POLLS    3     /* LINK_IDLE answers with jobs dealt (the first may predate them): lost */
+
+#define RX_SYNC    0
+#define RX_TYPE    1
+#define RX_HEADER  2
+#define RX_DATA    3
+#define RX_SUM     4
+#define RX_SUM2    5
+
+static volatile uint8_t role;
+static uint8_t hello[HELLO_SIZE];
+static uint8_t buffer[LINK_ROW_MAX];    /* Master: the received row. Slave: the reply. */
+
+/* Jobs, oldest first. Master: dealt, no result yet. Slave: received, not
+ * taken. */
+static uint8_t job_view[LINK_JOBS], job_row[LINK_JOBS];
+static volatile uint8_t jobs;
+
+/* Master */
+static uint8_t partner;                 /* A slave answered the last probe */
+static uint8_t hello_frames;
+static uint8_t lost_polls;
+static uint8_t idle_polls;
+static volatile uint8_t in_flight;      /* A byte is being shifted */
+static volatile uint8_t result_ready;   /* buffer holds a row until link_release */
+static uint8_t result_view, result_row;
+static uint16_t result_len;
+
+/* Slave */
+static volatile uint8_t tracing;        /* A job is taken and not replied yet */
+static uint8_t slave_tx = LINK_IDLE;    /* Byte for the master's next exchange */
+
+/* Receive */
+static uint8_t rx_state;
+static uint8_t rx_type, rx_sum, rx_sum2, rx_sum_ok;
+static uint8_t rx_header[HEADER_MAX];
+static uint8_t rx_header_size, rx_header_n;
+static uint16_t rx_len, rx_n;
+
+/* Send: tx_head (LINK_SYNC, type, header), tx_len bytes of tx_data, the sums */
+static uint8_t tx_head[HEADER_MAX + 2];
+static uint8_t tx_head_size;
+static const uint8_t *tx_data;
+static uint16_t tx_len, tx_pos;
+static uint8_t tx_sum, tx_sum2;
+static volatile uint8_t tx_busy;
+
+static uint8_t header_size(uint8_t type) {
+    switch (type) {
+    case PACKET_HELLO:
+    case PACKET_ACK:   return HELLO_SIZE;
+    case PACKET_JOB:   return 2;
+    case PACKET_ROW:   return 4;
+    }
+    return 0;
+}
+
+/* Queue a packet (with interrupts off, or from a handler; tx idle). The
+ * data's sums start from 0; each of its bytes adds the head's first sum
+ * to the second once more. */
+static void set_packet(uint8_t type, const uint8_t *header, const uint8_t *data, uint16_t len,
+                       uint8_t data_sum, uint8_t data_sum2) {
+    uint8_t size = header_size(type);
+    uint8_t sum = type;
+    uint8_t sum2 = type;
+    
+    tx_head[0] = LINK_SYNC;
+    tx_head[1] = type;
+    for (uint8_t i = 0; i < size; i++) {
+        tx_head[2 + i] = header[i];
+        sum += header[i];
+        sum2 += sum;
+    }
+    tx_head_size = size + 2;
+    tx_data = data;
+    tx_len = len;
+    tx_sum = sum + data_sum;
+    tx_sum2 = sum2 + data_sum2 + (uint8_t)len * sum;
+    tx_pos = 0;
+    tx_busy = 1;
+}
+
+static uint8_t tx_next(void) {
+    if (!tx_busy) {
+        if (role == LINK_MASTER) return LINK_IDLE;
+        return (jobs || tracing) ? LINK_BUSY : LINK_IDLE;
+    }
+    
+    uint16_t i = tx_pos++;
+    if (i < tx_head_size) return tx_head[i];
+    i -= tx_head_size;
+    if (i < tx_len) return tx_data[i];
+    if (i == tx_len) return tx_sum;
+    tx_busy = 0;
+    return tx_sum2;
+}
+
+/* Forget the n oldest jobs (interrupts off, or from a handler) */
+static void drop_jobs(uint8_t n) {
+    for (uint8_t i = n; i < jobs; i++) {
+        job_view[i - n] = job_view[i];
+        job_row[i - n] = job_row[i];
+    }
+    jobs -= n;
+}
+
+/*============================================================================
+ * RECEIVE (both roles, from their interrupt handlers)
+ *============================================================================*/
+
+/* Master: a byte between packets */
+static void state_byte(uint8_t b) {
+    if (b != LINK_IDLE && b != LINK_BUSY) {
+        if (partner && ++lost_polls >= LOST_POLLS) {
+            partner = 0;
+            jobs = 0;
+        }
+        return;
+    }
+    
+    lost_polls = 0;
+    if (!jobs || tx_busy) return;
+    if (b == LINK_BUSY) {
+        idle_polls = 0;
+    } else if (++idle_polls >= IDLE_POLLS) {
+        jobs = 0;
+    }
+}
+
+/* Master: the slave answers in order, so jobs before the row's were lost;
+ * a row that fails its sum is most likely the oldest job's */
+static void row_received(uint8_t ok) {
+    if (!ok) {
+        drop_jobs(1);
+        return;
+    }
+    for (uint8_t i = 0; i < jobs; i++) {
+        if (rx_header[0] == job_view[i] && rx_header[1] == job_row[i]) {
+            result_view = job_view[i];
+            result_row = job_row[i];
+            result_len = rx_len;
+            result_ready = 1;
+            drop_jobs(i + 1);
+            return;
+        }
+    }
+}
+
+static void packet_received(uint8_t ok) {
+    if (role == LINK_MASTER) {
+        if (rx_type == PACKET_ACK) {
+            if (ok && memcmp(rx_header, hello, HELLO_SIZE) == 0) partner = 1;
+        } else if (rx_type == PACKET_ROW && jobs) {
+            row_received(ok);
+        }
+        return;
+    }
+    
+    if (!ok) return;
+    if (rx_type == PACKET_HELLO) {
+        if (memcmp(rx_header, hello, HELLO_SIZE) != 0) return;
+        role = LINK_SLAVE;
+        if (!tx_busy) set_packet(PACKET_ACK, hello, 0, 0, 0, 0);
+    } else if (rx_type == PACKET_JOB && role == LINK_SLAVE && jobs < LINK_JOBS) {
+        /* Taken once the one traced is replied */
+        job_view[jobs] = rx_header[0];
+        job_row[jobs] = rx_header[1];
+        jobs++;
+    }
+}
+
+static void rx_add(uint8_t b) {
+    rx_sum += b;
+    rx_sum2 += rx_sum;
+}
+
+static void rx_byte(uint8_t b) {
+    switch (rx_state) {
+    case RX_SYNC:
+        if (b == LINK_SYNC) {
+            rx_state = RX_TYPE;
+        } else if (role == LINK_MASTER) {
+            state_byte(b);
+        }
+        return;
+    
+    case RX_TYPE:
+        rx_type = b;
+        rx_sum = rx_sum2 = b;
+        rx_header_size = header_size(b);
+        rx_header_n = 0;
+        rx_state = rx_header_size ? RX_HEADER : RX_SYNC;
+        return;
+    
+    case RX_HEADER:
+        rx_header[rx_header_n++] = b;
+        rx_add(b);
+        if (rx_header_n < rx_header_size) return;
+        
+        rx_len = 0;
+        if (rx_type == PACKET_ROW) {
+            /* Only into a buffer that is not holding a result */
+            rx_len = rx_header[2] | ((uint16_t)rx_header[3] << 8);
+            if (role != LINK_MASTER || !jobs || result_ready || rx_len > LINK_ROW_MAX) {
+                rx_state = RX_SYNC;
+                return;
+            }
+        }
+        rx_n = 0;
+        rx_state = rx_len ? RX_DATA : RX_SUM;
+        return;
+    
+    case RX_DATA:
+        buffer[rx_n++] = b;
+        rx_add(b);
+        if (rx_n == rx_len) rx_state = RX_SUM;
+        return;
+    
+    case RX_SUM:
+        rx_sum_ok = (b == rx_sum);
+        rx_state = RX_SUM2;
+        return;
+    
+    case RX_SUM2:
+        rx_state = RX_SYNC;
+        packet_received(rx_sum_ok && b == rx_sum2);
+        return;
+    }
+}
+
+/*============================================================================
+ * CLOCK
+ *============================================================================*/
+
+/* Master, with interrupts off: shift the next byte. Not while a result
+ * waits for link_release, as the next row would go into its buffer. */
+static void master_clock(void) {
+    if (in_flight || result_ready) return;
+    
+    SB_REG = tx_next();
+    SC_REG = SIOF_XFER_START | SIOF_SPEED_32X | SIOF_CLOCK_INT;
+    in_flight = 1;
+}
+
+static void link_sio_isr(void) {
+    uint8_t b = SB_REG;
+    
+    /* Slave (and a unit that has no role yet): the master may clock the
+     * next byte right after its handler is done with this one */
+    if (role != LINK_MASTER) {
+        SB_REG = slave_tx;
+        SC_REG = SIOF_XFER_START | SIOF_CLOCK_EXT;
+        rx_byte(b);
+        slave_tx = tx_next();
+        return;
+    }
+    
+    /* Master: back to back while a packet is going either way */
+    in_flight = 0;
+    rx_byte(b);
+    if (tx_busy || rx_state != RX_SYNC) master_clock();
+}
+
+static void link_vbl_isr(void) {
+    if (role != LINK_MASTER) return;
+    
+    if (!partner && !tx_busy && ++hello_frames >= HELLO_FRAMES) {
+        hello_frames = 0;
+        set_packet(PACKET_HELLO, hello, 0, 0, 0, 0);
+    }
+    master_clock();
+}
+
+/*============================================================================
+ * ROLES
+ *============================================================================*/
+
+void link_init(void) {
+    /* ROM bank 1 (raytracer_init) holds scene_hash */
+    hello[0] = LINK_VERSION;
+    memcpy(&hello[1], &scene_hash, sizeof(scene_hash));
+    
+    CRITICAL {
+        add_SIO(link_sio_isr);
+        add_VBL(link_vbl_isr);
+        SB_REG = LINK_IDLE;
+        SC_REG = SIOF_XFER_START | SIOF_CLOCK_EXT;
+    }
+    set_interrupts(IE_REG | SIO_IFLAG);
+}
+
+void link_start_master(void) {
+    CRITICAL {
+        if (role == LINK_NONE) {
+            role = LINK_MASTER;
+            rx_state = RX_SYNC;
+            tx_busy = 0;
+            SC_REG = 0;
+            hello_frames = HELLO_FRAMES - 1;   /* Probe at the next VBlank */
+        }
+    }
+}
+
+uint8_t link_role(void) {
+    return role;
+}
+
+/*============================================================================
+ * MASTER
+ *============================================================================*/
+
+uint8_t link_free(void) {
+    return partner && jobs < LINK_JOBS && !tx_busy;
+}
+
+void link_send_job(uint8_t view_id, uint8_t tile_row) {
+    uint8_t header[2];
+    
+    header[0] = view_id;
+    header[1] = tile_row;
+    CRITICAL {
+        job_view[jobs] = view_id;
+        job_row[jobs] = tile_row;
+        jobs++;
+        idle_polls = 0;
+        set_packet(PACKET_JOB, header, 0, 0, 0, 0);
+        master_clock();
+    }
+}
+
+uint8_t link_dealt(uint8_t view_id, uint8_t tile_row) {
+    uint8_t dealt = 0;
+    
+    CRITICAL {
+        if (result_ready && result_view == view_id && result_row == tile_row) dealt = 1;
+        for (uint8_t i = 0; i < jobs; i++) {
+            if (job_view[i] == view_id && job_row[i] == tile_row) dealt = 1;
+        }
+    }
+    return dealt;
+}
+
+const uint8_t *link_result(uint8_t *view_id, uint8_t *tile_row, uint16_t *len) {
+    if (!result_ready) return 0;
+    *view_id = result_view;
+    *tile_row = result_row;
+    *len = result_len;
+    return buffer;
+}
+
+void link_release(void) {
+    CRITICAL {
+        result_ready = 0;
+        master_clock();
+    }
+}
+
+/*============================================================================
+ * SLAVE
+ * Only link.c's serial handler runs from serve_link on (main.c), and the
+ * sections here that hold it off are a few loads and stores long.
+ *============================================================================*/
+
+uint8_t link_job(uint8_t *view_id, uint8_t *tile_row) {
+    if (!jobs) return 0;
+    
+    CRITICAL {
+        *view_id = job_view[0];
+        *tile_row = job_row[0];
+        tracing = 1;
+        drop_jobs(1);
+    }
+    return 1;
+}
+
+uint8_t link_replying(void) {
+    return tx_busy;
+}
+
+uint8_t *link_reply_buffer(void) {
+    return buffer;
+}
+
+void link_reply(uint8_t view_id, uint8_t tile_row, uint16_t len) {
+    uint8_t header[4];
+    uint8_t sum = 0, sum2 = 0;
+    
+    header[0] = view_id;
+    header[1] = tile_row;
+    header[2] = (uint8_t)len;
+    header[3] = (uint8_t)(len >> 8);
+    for (uint16_t i = 0; i < len; i++) {
+        sum += buffer[i];
+        sum2 += sum;
+    }
+    
+    /* An ACK to a repeated probe may still be going out */
+    while (tx_busy);
+    CRITICAL {
+        set_packet(PACKET_ROW, header, buffer, len, sum, sum2);
+        tracing = 0;
+    }
+}
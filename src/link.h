@@ -0,0 +1,71 @@
+/**
+ * link.h - Rendering partner over the link cable (make LINK_CABLE=ON)
+ *
+ * Two units run the same ROM and listen on the serial port from boot. The
+ * first one where START is pressed becomes the master: it clocks the link
+ * and deals tile rows of its background views to the other one, the slave,
+ * which traces them and sends them back packed (raytracer_pack_row). Only
+ * the master shows the gallery; the slave stays on the title screen.
+ * Either side works alone: a row the partner does not deliver in time is
+ * traced by the master itself.
+ */
+
+#ifndef _LINK_H
+#define _LINK_H
+
+#include <stdint.h>
+#include "raytracer.h"
+
+#define LINK_NONE    0   /* No partner yet: listening */
+#define LINK_MASTER  1
+#define LINK_SLAVE   2
+
+/* Packed tile row: at most 18 bytes per tile (TILE_CODE_MAX) */
+#define LINK_ROW_MAX  (RENDER_TILES_X * 18)
+
+/* Jobs with the partner at once: the one it traces and the next */
+#define LINK_JOBS     2
+
+/* Listen for a master (call once, after raytracer_init) */
+void link_init(void);
+
+/* START pressed: become the master unless a master already took this unit */
+void link_start_master(void);
+
+uint8_t link_role(void);
+
+/*============================================================================
+ * MASTER: up to LINK_JOBS jobs, answered in the order dealt
+ *============================================================================*/
+
+/* A partner answered and can take another job */
+uint8_t link_free(void);
+
+/* Deal a tile row of view_id to the partner */
+void link_send_job(uint8_t view_id, uint8_t tile_row);
+
+/* The dealt row is still with the partner or its result is waiting; 0
+ * once the job is lost (bad checksum, partner gone) or released */
+uint8_t link_dealt(uint8_t view_id, uint8_t tile_row);
+
+/* The partner's packed row, or 0 while there is none; it stays valid
+ * until link_release, and the link waits until then */
+const uint8_t *link_result(uint8_t *view_id, uint8_t *tile_row, uint16_t *len);
+void link_release(void);
+
+/*============================================================================
+ * SLAVE
+ *============================================================================*/
+
+/* Take the oldest job the master sent, if any */
+uint8_t link_job(uint8_t *view_id, uint8_t *tile_row);
+
+/* The last reply is still going out of the reply buffer */
+uint8_t link_replying(void);
+
+/* Once link_replying is 0: pack the job's row here (LINK_ROW_MAX bytes),
+ * then send len of them */
+uint8_t *link_reply_buffer(void);
+void link_reply(uint8_t view_id, uint8_t tile_row, uint16_t len);
+
+#endif
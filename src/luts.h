@@ -0,0 +1,108 @@
+/**
+ * luts.h - Precomputed raytracer tables (generated into ROM at build time)
+ *
+ * The tables are produced on the host by tools/genluts.c and emitted as
+ * const data into ROM bank 1 (src/luts.c is generated, not edited).
+ * Nothing here is computed on the Game Boy.
+ */
+
+#ifndef _LUTS_H
+#define _LUTS_H
+
+#include <stdint.h>
+#include "raytracer.h"
+
+/*============================================================================
+ * TABLE DIMENSIONS
+ *============================================================================*/
+
+/* Sphere intersection: d_dot_d ranges from ~256 to ~706 based on screen
+ * coordinates, quantized into 64 entries */
+#define LUT_MIN_VAL   256
+#define LUT_MAX_VAL   768
+#define LUT_SHIFT     3       /* Divide d_dot_d range by 8 */
+#define LUT_SIZE      64      /* (768-256)/8 = 64 entries */
+
+/* Sphere LUT index per pixel, folded into one quadrant: |px - W/2| and
+ * |py - H/2| both run 0-48 (full screen: 0-80 and 0-72) */
+#define LUT_FOLD_SIZE  (RENDER_WIDTH / 2 + 1)   /* 49 */
+#define LUT_FOLD_ROWS  (RENDER_HEIGHT / 2 + 1)  /* 49 */
+
+/* Shadow brightness: shadow_dist_sq 0 to ~1200, quantized to 128 entries */
+#define SHADOW_LUT_SIZE   128
+#define SHADOW_LUT_SHIFT  3     /* Divide shadow_dist_sq by 8 for indexing */
+
+#define RAY_STEP_FP   5       /* dx_fp/dy_fp change per pixel */
+
+/* OPTIMIZATION 5: t of the ray from the sphere center along the light
+ * down to the ground, SPHERE_CY / LIGHT_Y (8.8 constant) */
+#define SHADOW_T_FP   ((int16_t)(((int32_t)SPHERE_CY << 16) / LIGHT_Y))
+
+/* dz_fp is FX8_ONE for every ray */
+#define DZ_SQ_CONSTANT  ((int32_t)FX8_ONE * FX8_ONE)
+
+/*============================================================================
+ * VIEW-INDEPENDENT TABLES
+ *============================================================================*/
+
+/* OPTIMIZATION 2: Per-scanline ground intersection, one record per row so a
+ * scanline fetches it once. With dz_fp = FX8_ONE the hit's ground_z is
+ * t_ground itself. */
+#define SCANLINE_NO_GROUND  INT16_MAX   /* t_ground of a sky row: every t_hit is nearer */
+
+typedef struct {
+    int16_t t_ground;       /* 16 < t < 2000 (8.8), SCANLINE_NO_GROUND if !hit_ground */
+    int16_t ground_step;    /* RAY_STEP_FP * t_ground, < 10000 */
+    int16_t ground_x0;      /* (dx_fp * t_ground) >> 8 at px = 0 */
+    int16_t px_per_x;       /* (1 << 24) / ground_step: columns per ground_x, 16.16 */
+    uint8_t ground_frac0;   /* Low byte of dx_fp * t_ground at px = 0 */
+    uint8_t hit_ground;
+} scanline_luts_t;
+
+extern const scanline_luts_t scanline_luts[RENDER_HEIGHT];
+
+/* OPTIMIZATION 3: Sphere LUT index of each pixel, [|dy| / RAY_STEP_FP][|dx| / RAY_STEP_FP]
+ * (d_dot_d only depends on dx^2 + dy^2, the same for every view; the ray
+ * direction tables it is built from stay in tools/genluts) */
+extern const uint8_t sphere_lut_fold[LUT_FOLD_ROWS][LUT_FOLD_SIZE];
+
+/* OPTIMIZATION 4: shadow_dist_sq >> SHADOW_LUT_SHIFT -> brightness (0-255) */
+extern const uint8_t shadow_brightness_lut[SHADOW_LUT_SIZE];
+
+/*============================================================================
+ * PER-VIEW TABLES (selected by pointer in raytracer_set_view)
+ *============================================================================*/
+
+/* OPTIMIZATION 13: One sphere of the view. Its image is the one of a sphere
+ * straight ahead at its depth, moved by shift columns. */
+typedef struct {
+    int16_t cx;                     /* Center (8.8; y is SPHERE_CY) */
+    int16_t cz;                     /* Depth (whole units) */
+    int8_t shift;                   /* Column of the center - RENDER_WIDTH / 2 */
+    uint8_t tile_x0, tile_x1;       /* Tiles the image touches (inclusive; */
+    uint8_t tile_y0, tile_y1;       /* tile_y0 > tile_y1: none) */
+    
+    /* OPTIMIZATION 1: oc_dot_d is constant because oc_y_fp = 0 */
+    int16_t oc_dot_d;
+    uint8_t lut_hit_end;            /* LUT indices below it hit the sphere */
+    int16_t lut_t_hit[LUT_SIZE];    /* (oc_dot_d << FX8_SHIFT) / d_dot_d */
+    int16_t lut_proj_sq[LUT_SIZE];  /* (oc_dot_d * oc_dot_d) / d_dot_d */
+} object_luts_t;
+
+typedef struct {
+    /* Camera parameters (VIEW_PARAMS) */
+    int16_t sphere_cz;
+    int8_t light_dir_x;
+    int8_t light_dir_z;
+    
+    /* SCENE_OBJECTS placed in this view, far to near */
+    object_luts_t objects[NUM_OBJECTS];
+} view_luts_t;
+
+extern const view_luts_t view_luts[NUM_VIEWS];
+
+/* OPTIMIZATION 15: Hash of the scene constants and every table above; a
+ * view cached in SRAM is only used by the build that has the same one */
+extern const uint32_t scene_hash;
+
+#endif
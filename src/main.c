@@ -1,8 +1,15 @@
 /**
- * main.c - 2-View Gallery Raytracer with Title Screen
+ * main.c - 4-View Gallery Raytracer with Title Screen
  * 
- * Shows title screen, then pre-renders front and back views.
- * D-pad Up/Down switches between views.
+ * Shows title screen, tracing the views off screen while it waits for START,
+ * then the front view; the other views keep being traced in the background
+ * of the input loop (or loads them all from ROM when built with
+ * PRERENDERED=ON; SRAM_CACHE=ON skips the views an earlier boot left in
+ * cartridge SRAM; LINK_CABLE=ON shares them with a second unit over the
+ * link cable, which then renders for this one).
+ * D-pad Up/Down switches sphere distance, Left/Right the light side
+ * (held with MOVING_LIGHT=ON they slide the light, with LIGHT_SWEEP=ON they
+ * turn it around the scene).
  */
 
 #include <gb/gb.h>
@@ -12,8 +19,14 @@
 
 #include "graphics.h"
 #include "raytracer.h"
+#include "upload_queue.h"
+#include "profile.h"
 #include "util.h"
+#include "wram.h"
 #include "TitleScreen.h"
+#ifdef LINK_CABLE
+#include "link.h"
+#endif
 
 /*============================================================================
  * TITLE SCREEN
@@ -44,7 +57,7 @@ static void show_title_screen(void) {
     
     /* Set palette attributes for multi-color "COLOR" text */
     VBK_REG = 1;  /* Switch to VRAM bank 1 (attributes) */
-    uint8_t attr_map[20 * 18];
+    uint8_t *attr_map = wram_arena.title_attr;   /* Nothing is traced yet (wram.h) */
     
     /* Default: use palette 0 for all tiles (black text, red for C) */
     for (uint16_t i = 0; i < 20 * 18; i++) {
@@ -81,6 +94,30 @@ static void show_title_screen(void) {
     DISPLAY_ON;
 }
 
+static void background_frame(void);
+
+#ifdef LINK_CABLE
+/* Picked by a master on the other end of the cable: trace its rows from
+ * now on, with the title screen left up. Only the serial interrupt runs,
+ * so its handler has the next byte in place before the master clocks it
+ * (link.c). A row is traced while the last one is still going out. */
+static void serve_link(void) {
+    upload_queue_flush();
+    set_interrupts(SIO_IFLAG);
+    
+    while (1) {
+        uint8_t view_id, tile_row;
+        
+        if (link_job(&view_id, &tile_row)) {
+            raytracer_trace_row(view_id, tile_row);
+            while (link_replying());
+            link_reply(view_id, tile_row, raytracer_pack_row(view_id, tile_row, link_reply_buffer()));
+        }
+    }
+}
+#endif
+
+/* Frames spent waiting still trace background views */
 static void wait_for_start(void) {
     uint8_t last_keys = joypad();
     
@@ -93,8 +130,19 @@ static void wait_for_start(void) {
         
         /* Wait for START or A button */
         if (pressed & (J_START | J_A)) {
+#ifdef LINK_CABLE
+            /* A unit a master already took does not become one */
+            link_start_master();
+            if (link_role() == LINK_MASTER) break;
+#else
             break;
+#endif
         }
+        
+#ifdef LINK_CABLE
+        if (link_role() == LINK_SLAVE) serve_link();
+#endif
+        background_frame();
     }
 }
 
@@ -102,14 +150,28 @@ static void wait_for_start(void) {
  * PROGRESS BAR
  * 
  * Shows rendering progress at top of screen using colored tiles.
- * Uses tile 145 (after render tiles 1-144).
+ * Uses tile 145 (after render tiles 1-144; FULL_SCREEN: 241, after bank
+ * 0's render tiles). A full screen has no row to spare, so there the bar
+ * is the window's first row, shown over the bottom tile row while it
+ * fills.
  *============================================================================*/
 
 #define TILE_BORDER     0
-#define TILE_PROGRESS   (RENDER_TILE_BASE + MAX_RENDER_TILES)  /* 145 */
+#define TILE_PROGRESS   (RENDER_TILE_BASE + RENDER_BANK_TILES)  /* 145 */
+#ifdef FULL_SCREEN
+#define PROGRESS_Y      32   /* Row 0 of the window map at 0x9C00 */
+#else
 #define PROGRESS_Y      0
+#endif
 #define PROGRESS_WIDTH  20
 
+#ifdef MOVING_LIGHT
+/* The light side is not a view of its own: only near and far are rendered */
+#define GALLERY_VIEWS   2   /* VIEW_FRONT, VIEW_BACK */
+#else
+#define GALLERY_VIEWS   NUM_VIEWS
+#endif
+
 static void init_progress_tile(void) {
     /* Create progress tile - solid color 2 (green) */
     uint8_t progress_tile[16] = {
@@ -117,29 +179,54 @@ static void init_progress_tile(void) {
         0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF
     };  /* This makes color index 2 (green ground color) */
     set_bkg_data(TILE_PROGRESS, 1, progress_tile);
+    
+#ifdef FULL_SCREEN
+    /* An empty bar in the window's first row (border palette, VRAM bank 0),
+     * its top at the bottom tile row; hidden until it fills */
+    uint8_t bar_row[PROGRESS_WIDTH];
+    memset(bar_row, TILE_BORDER, PROGRESS_WIDTH);
+    set_win_tiles(0, 0, PROGRESS_WIDTH, 1, bar_row);
+    VBK_REG = VBK_ATTRIBUTES;
+    memset(bar_row, 1, PROGRESS_WIDTH);
+    set_win_tiles(0, 0, PROGRESS_WIDTH, 1, bar_row);
+    VBK_REG = VBK_TILES;
+    
+    WX_REG = 7;
+    WY_REG = 144 - 8;
+    LCDC_REG |= LCDCF_WIN9C00;
+    HIDE_WIN;
+#endif
 }
 
+static uint8_t progress_filled;  /* Bar cells already queued */
+
 static void show_progress_scanline(uint8_t view, uint8_t scanline) {
-    /* Progress: view * 96 + scanline out of 192 total scanlines */
-    uint16_t total = NUM_VIEWS * RENDER_HEIGHT;
+    /* Progress: view * RENDER_HEIGHT + scanline out of GALLERY_VIEWS *
+     * RENDER_HEIGHT scanlines */
+    uint16_t total = GALLERY_VIEWS * RENDER_HEIGHT;
     uint16_t current = view * RENDER_HEIGHT + scanline;
     uint8_t filled = (uint8_t)((current * PROGRESS_WIDTH) / total);
     
-    uint8_t bar[PROGRESS_WIDTH];
-    for (uint8_t i = 0; i < PROGRESS_WIDTH; i++) {
-        bar[i] = (i < filled) ? TILE_PROGRESS : TILE_BORDER;
+    /* The bar only grows: queue just the new cells, and only when it moves */
+    if (filled > progress_filled) {
+        upload_queue_map_fill(progress_filled, PROGRESS_Y, filled - progress_filled, TILE_PROGRESS);
+        progress_filled = filled;
+#ifdef FULL_SCREEN
+        SHOW_WIN;
+#endif
     }
-    set_bkg_tiles(0, PROGRESS_Y, PROGRESS_WIDTH, 1, bar);
 }
 
 static void clear_progress(void) {
-    uint8_t bar[PROGRESS_WIDTH];
-    for (uint8_t i = 0; i < PROGRESS_WIDTH; i++) {
-        bar[i] = TILE_BORDER;
-    }
-    set_bkg_tiles(0, PROGRESS_Y, PROGRESS_WIDTH, 1, bar);
+    progress_filled = 0;
+    upload_queue_map_fill(0, PROGRESS_Y, PROGRESS_WIDTH, TILE_BORDER);
+    upload_queue_flush();
+#ifdef FULL_SCREEN
+    HIDE_WIN;
+#endif
 }
 
+#ifdef PROFILE
 static void clear_render_area(void) {
     /* Clear all render tiles to empty/black */
     uint8_t empty_tile[16];
@@ -149,25 +236,106 @@ static void clear_render_area(void) {
         set_bkg_data(RENDER_TILE_BASE + i, 1, empty_tile);
     }
 }
+#endif
+
+/*============================================================================
+ * FRAME SCHEDULER
+ * 
+ * The joypad is read once per frame, also in the middle of a render, and
+ * its presses are kept until the main loop takes them. Background work
+ * fills each frame up to the next VBlank: LY_REG tells how many LCD lines
+ * (456 clocks each) are left, and a step is only started if the last
+ * one's cost in LCD lines still fits. Costs are timed in frames (sys_time)
+ * and LCD lines, so a step that ran past a VBlank or two is still counted
+ * in full.
+ *============================================================================*/
+
+#define LY_VBLANK  144   /* First LCD line of VBlank */
+#define LY_FRAME   154   /* LCD lines per frame */
+
+static uint8_t input_frame;   /* sys_time of the last joypad read */
+static uint8_t held_keys;
+static uint8_t pressed_keys;  /* Presses not taken by the main loop yet */
+
+static void poll_input(void) {
+    if ((uint8_t)sys_time == input_frame) return;
+    input_frame = (uint8_t)sys_time;
+    
+    uint8_t keys = joypad();
+    pressed_keys |= keys & ~held_keys;
+    held_keys = keys;
+}
+
+static uint8_t take_pressed(void) {
+    uint8_t pressed = pressed_keys;
+    pressed_keys = 0;
+    return pressed;
+}
+
+/* LCD lines until the next VBlank starts (during VBlank: the whole frame) */
+static uint8_t lines_to_vblank(void) {
+    uint8_t ly = LY_REG;
+    return (ly < LY_VBLANK) ? LY_VBLANK - ly : LY_VBLANK + LY_FRAME - ly;
+}
+
+typedef struct {
+    uint8_t frame;   /* sys_time, counted at the start of VBlank */
+    uint8_t line;    /* LCD lines since then */
+} lcd_time_t;
+
+static void read_lcd_time(lcd_time_t *t) {
+    /* Read again if the VBlank interrupt came in between */
+    do {
+        t->frame = (uint8_t)sys_time;
+        uint8_t ly = LY_REG;
+        t->line = (ly >= LY_VBLANK) ? ly - LY_VBLANK : ly + (LY_FRAME - LY_VBLANK);
+    } while (t->frame != (uint8_t)sys_time);
+}
+
+/* LCD lines from start to end, up to 255 frames apart */
+static uint16_t lcd_lines_since(const lcd_time_t *start, const lcd_time_t *end) {
+    return (uint16_t)(uint8_t)(end->frame - start->frame) * LY_FRAME + end->line - start->line;
+}
 
 /*============================================================================
  * RENDER ONE VIEW (SCANLINE-BY-SCANLINE for smooth visual feedback)
+ * 
+ * PROFILE builds render every view on screen and PROGRESSIVE ones the front
+ * view, coarse to fine; the rest is traced in the background (see
+ * BACKGROUND RENDERING), from the title screen on.
  *============================================================================*/
 
+#if defined(PROFILE) || defined(PROGRESSIVE)
 static void render_view(uint8_t view_id) {
     raytracer_set_view(view_id);
     
-    /* Render 96 scanlines, one at a time */
-    for (uint8_t py = 0; py < RENDER_HEIGHT; py++) {
+    /* Uniform tiles show up immediately through the shared sky/ground tiles */
+    raytracer_load_map(view_id);
+    
+    /* Render the scanlines one at a time; uploads go to the VBlank queue,
+     * so tracing never waits for the frame */
+    for (uint8_t i = 0; i < RENDER_HEIGHT; i++) {
+#ifdef PROGRESSIVE
+        /* Coarse-to-fine order; tile rows still complete top to bottom */
+        uint8_t py = raytracer_progressive_scanline(i);
+#else
+        uint8_t py = i;
+#endif
+        
         /* Render single scanline */
         raytracer_render_scanline(py);
+        poll_input();
         
-        /* Update progress bar */
-        show_progress_scanline(view_id, py + 1);
-        
-        /* Wait for VBlank and upload scanline */
-        wait_vbl_done();
+        /* Queue the scanline's tile row and the progress bar */
+        PROFILE_BEGIN(prof_start);
         raytracer_upload_scanline(py);
+        PROFILE_END(PROF_UPLOAD, prof_start);
+#ifdef PROFILE
+        /* The HUD takes the progress bar's row */
+        profile_hud_scanline(i + 1);
+#else
+        show_progress_scanline(view_id, i + 1);
+#endif
         
         /* When we complete a tile row (every 8 scanlines), store it */
         if ((py & 7) == 7) {
@@ -176,6 +344,119 @@ static void render_view(uint8_t view_id) {
         }
     }
 }
+#endif
+
+/*============================================================================
+ * BACKGROUND RENDERING
+ * 
+ * Views after the front one are traced in gallery order while the front
+ * view is already on screen, in the time each frame has left after input.
+ * Switching to a view that is not done yet waits for it, with the progress
+ * bar.
+ *============================================================================*/
+
+static uint8_t ready_views;    /* Bit v: view v is stored */
+static uint8_t background_view = GALLERY_VIEWS;  /* View being traced (GALLERY_VIEWS: none) */
+static uint8_t step_lines = 1;       /* LCD lines the last background step took */
+
+/* Cost of a step the scheduler holds on to: one that took longer still
+ * starts from VBlank, where more than this is left of the frame */
+#define STEP_LINES_MAX  (LY_VBLANK - 1)
+
+static uint8_t view_ready(uint8_t view_id) {
+    return ready_views & (1 << view_id);
+}
+
+static void view_done(uint8_t view_id) {
+    ready_views |= 1 << view_id;
+#ifdef SRAM_CACHE
+    raytracer_cache_view(view_id);
+#endif
+}
+
+/* Trace the first view from view_id on that is not stored yet */
+static void start_background(uint8_t view_id) {
+    while (view_id < GALLERY_VIEWS && view_ready(view_id)) {
+        view_id++;
+    }
+    background_view = view_id;
+    if (view_id < GALLERY_VIEWS) {
+        raytracer_background_begin(view_id);
+    }
+}
+
+static void background_step(void) {
+    if (!raytracer_background_step()) {
+        view_done(background_view);
+        start_background(background_view + 1);
+    }
+}
+
+/* Background steps for the rest of the frame */
+static void background_frame(void) {
+    while (background_view < GALLERY_VIEWS && lines_to_vblank() > step_lines) {
+        lcd_time_t start, end;
+        
+        read_lcd_time(&start);
+        background_step();
+        read_lcd_time(&end);
+        
+        /* Rounded up */
+        uint16_t lines = lcd_lines_since(&start, &end) + 1;
+        step_lines = (lines < STEP_LINES_MAX) ? (uint8_t)lines : STEP_LINES_MAX;
+    }
+}
+
+/* The gallery view the D-pad presses lead to from view_id */
+static uint8_t select_view(uint8_t view_id, uint8_t pressed) {
+#ifdef MOVING_LIGHT
+    /* Up/Down pick the sphere distance; Left/Right move the light instead */
+    if (pressed & J_DOWN) view_id = VIEW_FRONT;
+    if (pressed & J_UP)   view_id = VIEW_BACK;
+    return view_id;
+#else
+    /* Up/Down pick the sphere distance, Left/Right the light side */
+    uint8_t far = (view_id == VIEW_BACK || view_id == VIEW_BACK_RIGHT);
+    uint8_t right = (view_id == VIEW_FRONT_RIGHT || view_id == VIEW_BACK_RIGHT);
+    
+    if (pressed & J_DOWN)  far = 0;
+    if (pressed & J_UP)    far = 1;
+    if (pressed & J_LEFT)  right = 0;
+    if (pressed & J_RIGHT) right = 1;
+    
+    return right ? (far ? VIEW_BACK_RIGHT : VIEW_FRONT_RIGHT)
+                 : (far ? VIEW_BACK : VIEW_FRONT);
+#endif
+}
+
+/* Trace at full speed until view_id is ready; presses meanwhile can pick
+ * another view, and one that is already done ends the wait. Returns the
+ * view to show. */
+static uint8_t wait_for_view(uint8_t view_id) {
+    if (view_ready(view_id)) return view_id;
+    
+    while (!view_ready(view_id)) {
+        background_step();
+        show_progress_scanline(background_view, raytracer_background_progress());
+        poll_input();
+        view_id = select_view(view_id, take_pressed());
+    }
+    clear_progress();
+    return view_id;
+}
+
+#ifdef MOVING_LIGHT
+/* A relight renders, so the background views are finished first */
+static void finish_background(void) {
+    if (view_ready(GALLERY_VIEWS - 1)) return;
+    
+    while (!view_ready(GALLERY_VIEWS - 1)) {
+        background_step();
+        show_progress_scanline(background_view, raytracer_background_progress());
+    }
+    clear_progress();
+}
+#endif
 
 /*============================================================================
  * MAIN
@@ -183,7 +464,29 @@ static void render_view(uint8_t view_id) {
 
 void main(void) {
     uint8_t current_view = VIEW_FRONT;
-    uint8_t last_keys = 0;
+    
+    /* Raytracer state and the upload queue; neither touches VRAM, which
+     * belongs to the title screen until START */
+    raytracer_init();
+    upload_queue_init();
+#ifdef LINK_CABLE
+    link_init();
+#endif
+    
+#ifdef PRERENDERED
+    /* All views were rendered at build time and are loaded from ROM */
+    ready_views = (1 << GALLERY_VIEWS) - 1;
+#elif !defined(PROFILE)
+#ifdef SRAM_CACHE
+    /* Views rendered on an earlier boot come back from cartridge SRAM */
+    ready_views = raytracer_cache_restore();
+#endif
+    
+#ifndef PROGRESSIVE
+    /* The title screen's idle frames trace the views into the scene store */
+    start_background(VIEW_FRONT);
+#endif
+#endif
     
     /* === TITLE SCREEN === */
     LCDC_REG = LCDCF_OFF | LCDCF_BGON | LCDCF_BG8000;
@@ -197,44 +500,89 @@ void main(void) {
     raytracer_init_vram();
     setup_palette_attributes();
     init_progress_tile();
-    
-    /* Initialize raytracer LUTs and precomputed arrays */
-    raytracer_init();
+#ifdef PROFILE
+    profile_init();
+#endif
     
     DISPLAY_ON;
     
-    /* Pre-render both views */
-    render_view(VIEW_FRONT);
-    
-    /* Wipe screen before rendering second view */
-    wait_vbl_done();
-    clear_render_area();
-    
-    render_view(VIEW_BACK);
+#ifdef PROFILE
+    /* Render all views on screen: the summary times every one of them */
+    for (uint8_t v = 0; v < GALLERY_VIEWS; v++) {
+        profile_view_begin();
+        /* Wipe screen before rendering the next view */
+        if (v) {
+            PROFILE_BEGIN(prof_start);
+            upload_queue_flush();
+            wait_vbl_done();
+            PROFILE_END(PROF_WAIT, prof_start);
+            clear_render_area();
+        }
+        render_view(v);
+        profile_view_end(v);
+        ready_views |= 1 << v;
+    }
     
     clear_progress();
     
-    /* Load front view */
-    current_view = VIEW_FRONT;
+    /* Timings of every view until START or A */
+    profile_show_summary();
+    wait_for_start();
+    profile_hide_summary();
+#elif defined(PROGRESSIVE)
+    /* Coarse to fine on screen; the others follow in the background */
+    if (!view_ready(VIEW_FRONT)) {
+        render_view(VIEW_FRONT);
+        view_done(VIEW_FRONT);
+        clear_progress();
+    }
+    start_background(VIEW_FRONT + 1);
+#else
+    /* Whatever of the front view the title screen did not get to is traced
+     * now, with the progress bar */
+    current_view = wait_for_view(VIEW_FRONT);
+#endif
+    
     wait_vbl_done();
     raytracer_load_scene(current_view);
     
-    /* Main loop */
+    /* Main loop: input once per frame, the rest of the frame renders */
     while (1) {
         wait_vbl_done();
+        poll_input();
         
-        uint8_t keys = joypad();
-        uint8_t pressed = keys & ~last_keys;
-        last_keys = keys;
-        
-        uint8_t new_view = current_view;
-        
-        if (pressed & J_DOWN) new_view = VIEW_FRONT;
-        if (pressed & J_UP)   new_view = VIEW_BACK;
-        
+        uint8_t new_view = select_view(current_view, take_pressed());
         if (new_view != current_view) {
-            current_view = new_view;
+            current_view = wait_for_view(new_view);
             raytracer_load_scene(current_view);
         }
+        
+#ifdef MOVING_LIGHT
+        /* Left/Right held turn the light (LIGHT_SWEEP) or slide it, one
+         * relit step per frame */
+        uint8_t keys = held_keys;
+        if (keys & (J_LEFT | J_RIGHT)) {
+            finish_background();
+        }
+        
+#ifdef LIGHT_SWEEP
+        uint8_t angle = raytracer_light_angle(current_view);
+        if (keys & J_LEFT) {
+            raytracer_sweep_light(current_view, angle - SWEEP_STEP);
+        } else if (keys & J_RIGHT) {
+            raytracer_sweep_light(current_view, angle + SWEEP_STEP);
+        }
+#else
+        int16_t light_x = raytracer_light_x(current_view);
+        int16_t light_z = raytracer_light_z(current_view);
+        if ((keys & J_LEFT) && light_x > LIGHT_X_MIN) {
+            raytracer_move_light(current_view, light_x - LIGHT_MOVE_STEP, light_z);
+        } else if ((keys & J_RIGHT) && light_x < LIGHT_X_MAX) {
+            raytracer_move_light(current_view, light_x + LIGHT_MOVE_STEP, light_z);
+        }
+#endif
+#endif
+        
+        background_frame();
     }
 }
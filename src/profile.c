@@ -0,0 +1,228 @@
+/**
+ * profile.c - Optional render-phase timers and HUD (make PROFILE=ON)
+ *
+ * Only built with PROFILE (see Makefile). Values on screen are hex TIMA
+ * ticks: 16 clocks each, ~3.8 us.
+ */
+
+#include <gb/gb.h>
+#include <gb/cgb.h>
+#include <string.h>
+#include "profile.h"
+#include "graphics.h"
+#include "raytracer.h"
+#include "upload_queue.h"
+
+/*============================================================================
+ * TIMER
+ *============================================================================*/
+
+uint32_t profile_ticks[PROF_PHASES];
+
+static volatile uint32_t profile_overflows;   /* TIMA wraps (every 256 ticks) */
+
+static void profile_timer_isr(void) {
+    profile_overflows++;
+}
+
+static void load_font(void);
+
+void profile_init(void) {
+    /* Called with the display off: the HUD itself only queues map cells */
+    load_font();
+    
+    CRITICAL {
+        add_TIM(profile_timer_isr);
+        TMA_REG = 0;
+        TIMA_REG = 0;
+        TAC_REG = TACF_START | TACF_262KHZ;
+    }
+    set_interrupts(IE_REG | TIM_IFLAG);
+}
+
+uint32_t profile_now(void) {
+    uint32_t hi;
+    uint8_t lo;
+    
+    /* Retry if TIMA wrapped (and the handler ran) between the two reads */
+    do {
+        hi = profile_overflows;
+        lo = TIMA_REG;
+    } while (hi != profile_overflows);
+    
+    return (hi << 8) | lo;
+}
+
+/*============================================================================
+ * PER-VIEW TOTALS
+ *============================================================================*/
+
+static uint32_t view_ticks[NUM_VIEWS][PROF_PHASES];
+static uint32_t view_total[NUM_VIEWS];    /* Whole render_view */
+static uint32_t view_start;
+static uint8_t view_timed;                /* Bit v: view v has totals */
+
+void profile_view_begin(void) {
+    memset(profile_ticks, 0, sizeof(profile_ticks));
+    view_start = profile_now();
+}
+
+void profile_view_end(uint8_t view_id) {
+    view_total[view_id] = profile_now() - view_start;
+    memcpy(view_ticks[view_id], profile_ticks, sizeof(profile_ticks));
+    view_timed |= 1 << view_id;
+}
+
+/*============================================================================
+ * FONT (3x5 glyphs, color 1 on color 0, after the shared uniform tiles)
+ *============================================================================*/
+
+#define FONT_TILE     (RENDER_TILE_GROUND + 1)   /* 148 */
+#define GLYPH_BLANK   16
+#define GLYPH_S       17
+#define GLYPH_G       18
+#define GLYPH_P       19
+#define GLYPH_U       20
+#define GLYPH_W       21
+#define GLYPH_T       22
+#define GLYPH_V       23
+#define FONT_GLYPHS   24
+
+#define SCREEN_TILES_X  20
+#define SCREEN_TILES_Y  18
+
+/* One row per byte, 3 pixels in the low bits */
+static const uint8_t font_rows[FONT_GLYPHS][5] = {
+    { 0x7, 0x5, 0x5, 0x5, 0x7 }, { 0x2, 0x6, 0x2, 0x2, 0x7 },   /* 0 1 */
+    { 0x7, 0x1, 0x7, 0x4, 0x7 }, { 0x7, 0x1, 0x7, 0x1, 0x7 },   /* 2 3 */
+    { 0x5, 0x5, 0x7, 0x1, 0x1 }, { 0x7, 0x4, 0x7, 0x1, 0x7 },   /* 4 5 */
+    { 0x7, 0x4, 0x7, 0x5, 0x7 }, { 0x7, 0x1, 0x1, 0x1, 0x1 },   /* 6 7 */
+    { 0x7, 0x5, 0x7, 0x5, 0x7 }, { 0x7, 0x5, 0x7, 0x1, 0x7 },   /* 8 9 */
+    { 0x7, 0x5, 0x7, 0x5, 0x5 }, { 0x6, 0x5, 0x6, 0x5, 0x6 },   /* A B */
+    { 0x7, 0x4, 0x4, 0x4, 0x7 }, { 0x6, 0x5, 0x5, 0x5, 0x6 },   /* C D */
+    { 0x7, 0x4, 0x7, 0x4, 0x7 }, { 0x7, 0x4, 0x7, 0x4, 0x4 },   /* E F */
+    { 0x0, 0x0, 0x0, 0x0, 0x0 }, { 0x3, 0x4, 0x2, 0x1, 0x6 },   /* blank S */
+    { 0x3, 0x4, 0x5, 0x5, 0x3 }, { 0x6, 0x5, 0x6, 0x4, 0x4 },   /* G P */
+    { 0x5, 0x5, 0x5, 0x5, 0x7 }, { 0x5, 0x5, 0x5, 0x7, 0x5 },   /* U W */
+    { 0x7, 0x2, 0x2, 0x2, 0x2 }, { 0x5, 0x5, 0x5, 0x5, 0x2 }    /* T V */
+};
+
+static const uint8_t phase_glyph[PROF_PHASES] = { GLYPH_S, GLYPH_G, GLYPH_P, GLYPH_U, GLYPH_W };
+
+static uint8_t font_loaded;
+
+static void load_font(void) {
+    uint8_t tile[16];
+    
+    if (font_loaded) return;
+    
+    VBK_REG = VBK_TILES;
+    for (uint8_t g = 0; g < FONT_GLYPHS; g++) {
+        memset(tile, 0, 16);
+        for (uint8_t r = 0; r < 5; r++) {
+            tile[(r + 1) * 2] = font_rows[g][r] << 4;   /* Columns 1-3 */
+        }
+        set_bkg_data(FONT_TILE + g, 1, tile);
+    }
+    font_loaded = 1;
+}
+
+/* digits hex digits of v into cells, most significant first */
+static void put_hex(uint8_t *cells, uint32_t v, uint8_t digits) {
+    while (digits--) {
+        cells[digits] = FONT_TILE + ((uint8_t)v & 0x0F);
+        v >>= 4;
+    }
+}
+
+/* "Sxxx" for the first count phases, stride cells apart: average ticks
+ * per scanline, saturated at FFF */
+static void put_phase_averages(uint8_t *cells, const uint32_t *ticks, uint8_t scanlines,
+                               uint8_t count, uint8_t stride) {
+    for (uint8_t p = 0; p < count; p++) {
+        uint32_t avg = ticks[p] / scanlines;
+        if (avg > 0xFFF) avg = 0xFFF;
+        
+        cells[0] = FONT_TILE + phase_glyph[p];
+        put_hex(&cells[1], avg, 3);
+        cells += stride;
+    }
+}
+
+/*============================================================================
+ * HUD (replaces the progress bar) AND SUMMARY SCREEN
+ *============================================================================*/
+
+static uint8_t hud_cells[SCREEN_TILES_X];   /* Row the queue copies to the map */
+
+/* Counted as U: the averages (5 32-bit divides) and the queued row */
+void profile_hud_scanline(uint8_t scanlines) {
+    uint8_t cells[SCREEN_TILES_X];
+    PROFILE_BEGIN(prof_start);
+    
+    /* S G P U W, 4 cells each: fills the row */
+    put_phase_averages(cells, profile_ticks, scanlines, PROF_PHASES, 4);
+    
+    /* A row still pending takes the new cells along (merged push) */
+    if (memcmp(cells, hud_cells, SCREEN_TILES_X) != 0) {
+        memcpy(hud_cells, cells, SCREEN_TILES_X);
+        upload_queue_map_cells(0, 0, SCREEN_TILES_X, hud_cells);
+    }
+    
+    PROFILE_END(PROF_UPLOAD, prof_start);
+}
+
+void profile_show_summary(void) {
+    uint8_t cells[SCREEN_TILES_X];
+    
+    load_font();
+    wait_vbl_done();
+    
+    /* Whole screen: border palette, bank 0 tiles, blank */
+    memset(cells, 1, SCREEN_TILES_X);
+    VBK_REG = VBK_ATTRIBUTES;
+    for (uint8_t y = 0; y < SCREEN_TILES_Y; y++) {
+        set_bkg_tiles(0, y, SCREEN_TILES_X, 1, cells);
+    }
+    memset(cells, FONT_TILE + GLYPH_BLANK, SCREEN_TILES_X);
+    VBK_REG = VBK_TILES;
+    for (uint8_t y = 0; y < SCREEN_TILES_Y; y++) {
+        set_bkg_tiles(0, y, SCREEN_TILES_X, 1, cells);
+    }
+    
+    /* Per view, 4 rows:
+     *   V0 Txxxxxx Wxxxxxx   (render time and waits, total ticks)
+     *   Sxxx Gxxx Pxxx Uxxx  (ticks per scanline) */
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        uint8_t y = 1 + v * 4;
+        
+        /* MOVING_LIGHT renders only the gallery's views */
+        if (!(view_timed & (1 << v))) continue;
+        
+        memset(cells, FONT_TILE + GLYPH_BLANK, SCREEN_TILES_X);
+        cells[0] = FONT_TILE + GLYPH_V;
+        put_hex(&cells[1], v, 1);
+        cells[3] = FONT_TILE + GLYPH_T;
+        put_hex(&cells[4], view_total[v], 6);
+        cells[11] = FONT_TILE + GLYPH_W;
+        put_hex(&cells[12], view_ticks[v][PROF_WAIT], 6);
+        set_bkg_tiles(0, y, SCREEN_TILES_X, 1, cells);
+        
+        memset(cells, FONT_TILE + GLYPH_BLANK, SCREEN_TILES_X);
+        put_phase_averages(cells, view_ticks[v], RENDER_HEIGHT, PROF_PHASES - 1, 5);
+        set_bkg_tiles(0, y + 1, SCREEN_TILES_X, 1, cells);
+    }
+}
+
+void profile_hide_summary(void) {
+    uint8_t cells[SCREEN_TILES_X];
+    
+    /* Border everywhere again; the caller reloads the render area */
+    wait_vbl_done();
+    memset(cells, 0, SCREEN_TILES_X);
+    VBK_REG = VBK_TILES;
+    for (uint8_t y = 0; y < SCREEN_TILES_Y; y++) {
+        set_bkg_tiles(0, y, SCREEN_TILES_X, 1, cells);
+    }
+    setup_palette_attributes();
+}
@@ -0,0 +1,76 @@
+/**
+ * profile.h - Optional render-phase timers and HUD (make PROFILE=ON)
+ *
+ * TIMA counts at 262,144 Hz (one tick = 16 clocks, single speed) and its
+ * overflow interrupt extends it to 32 bits. Code sections bracketed with
+ * PROFILE_BEGIN / PROFILE_END add their ticks to one phase; without
+ * PROFILE the macros compile to nothing. Interrupt handlers (VBlank
+ * uploads, the timer itself) count towards the section they interrupt.
+ *
+ * COUNT_OP tallies operations for the host benchmark (tools/bench.c,
+ * built with HOST_BENCH) and is a no-op everywhere else.
+ */
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <stdint.h>
+
+#define PROF_SPHERE   0   /* trace_ray sphere shading */
+#define PROF_GROUND   1   /* Ground shadow walks */
+#define PROF_PACK     2   /* Bitplane bytes into the tile row buffer (and PROGRESSIVE stretch) */
+#define PROF_UPLOAD   3   /* Queueing uploads (includes waits for a free slot) and the HUD */
+#define PROF_WAIT     4   /* Stalls on the upload queue and VBlank */
+#define PROF_PHASES   5
+
+#ifdef PROFILE
+
+extern uint32_t profile_ticks[PROF_PHASES];
+
+uint32_t profile_now(void);
+
+#define PROFILE_BEGIN(t)        uint32_t t = profile_now()
+#define PROFILE_END(phase, t)   (profile_ticks[phase] += profile_now() - (t))
+
+/* Start the timer and its overflow interrupt */
+void profile_init(void);
+
+/* Bracket the render of one view: clears and then keeps its phase totals */
+void profile_view_begin(void);
+void profile_view_end(uint8_t view_id);
+
+/* Queue the phase averages (ticks per scanline) over the first scanlines
+ * rendered for the top row, if they changed; its time counts as
+ * PROF_UPLOAD */
+void profile_hud_scanline(uint8_t scanlines);
+
+/* Full-screen table of the totals of every view timed; hide restores the border */
+void profile_show_summary(void);
+void profile_hide_summary(void);
+
+#else
+
+#define PROFILE_BEGIN(t)
+#define PROFILE_END(phase, t)
+
+#endif
+
+/*============================================================================
+ * OPERATION COUNTS (host benchmark)
+ *============================================================================*/
+
+#define OP_TRACE_RAY    0   /* trace_ray calls */
+#define OP_INDEX_LUT    1   /* sphere_lut_fold lookups */
+#define OP_SPHERE_LUT   2   /* lut_t_hit / lut_proj_sq lookups (per hit test or trace) */
+#define OP_SHADOW_LUT   3   /* shadow_brightness_lut lookups */
+#define OP_MUL          4   /* Multiplies: fx_mul* calls and 16/32-bit C multiplies */
+#define OP_KINDS        5
+
+#ifdef HOST_BENCH
+extern uint32_t bench_ops[OP_KINDS];
+#define COUNT_OP(op)    (bench_ops[op]++)
+#else
+#define COUNT_OP(op)    ((void)0)
+#endif
+
+#endif
@@ -1,472 +1,1929 @@
 /**
- * raytracer.c - 2-view gallery raytracer with smooth dithered shading
+ * raytracer.c - 4-view gallery raytracer with smooth dithered shading
  * 
  * OPTIMIZED VERSION:
  * (1) LUTs eliminate per-pixel divisions for sphere intersection
  * (2) Ground intersection precomputed per scanline
  * (3) dx/dy arrays precomputed to avoid repeated calculations
+ * (4) Scanlines rendered as spans; only sphere/penumbra pixels are traced
+ * (5) Uniform sky/ground tiles share one VRAM tile and are never stored
+ * (6) Ground scanlines walked with additions only (no per-pixel multiply)
  */
 
 #include <gb/gb.h>
 #include <gb/cgb.h>
 #include <string.h>
 #include "raytracer.h"
+#include "luts.h"
+#include "vram_dma.h"
+#include "upload_queue.h"
+#include "profile.h"
+#include "wram.h"
+#ifdef PRERENDERED
+#include "scenes.h"
+#endif
+#ifdef LINK_CABLE
+#include "link.h"
+#endif
+
+BANKREF_EXTERN(raytracer_luts)
+
+/*============================================================================
+ * SCENE STORAGE
+ * Only mixed tiles are kept, compressed in tile-map order (see SCENE
+ * COMPRESSION) into the switchable CGB WRAM banks 1-6 at 0xD000, as one
+ * byte stream that runs on from the end of a bank into the next. Each
+ * view keeps its own tile map (an entry per render tile) in bank 0
+ * pointing uniform tiles at RENDER_TILE_SKY / RENDER_TILE_GROUND.
+ * Everything else, including the stack (see Makefile), stays in bank 0.
+ * On top of that, tiles 1-144 of both VRAM banks each hold a whole 96x96
+ * view; the render area's attribute bank bit picks the one on screen. A
+ * full screen takes both banks (see RENDER_BANK_ROWS), so one view is in
+ * VRAM.
+ *============================================================================*/
+
+/* Switchable WRAM window, bank selected by SVBK */
+#ifndef WRAMX_BASE
+#define WRAMX_BASE  ((uint8_t *)0xD000)
+#endif
+
+/* Phase arena in bank 0 (wram.h); the tile rows are in its render part */
+wram_arena_t wram_arena;
+
+/* The arena's size is counted in the bank 0 budget */
+typedef char wram_arena_budgeted[(sizeof(wram_arena_t) == WRAM0_ARENA_SIZE) ? 1 : -1];
+
+static uint8_t *tile_row_buffers[TILE_ROW_BUFFERS];
+static uint8_t tile_row_tickets[TILE_ROW_BUFFERS];   /* Last upload queued from each buffer */
+static uint8_t tile_row_index;
+static uint8_t *tile_row_buffer;      /* Row being rendered */
+
+/* Store positions count bytes from the start of SCENE_WRAM_FIRST_BANK */
+#define SCENE_STORE_SIZE  ((uint16_t)(SCENE_WRAM_LAST_BANK - SCENE_WRAM_FIRST_BANK + 1) * SCENE_WRAM_BANK_SIZE)
+
+static uint8_t scene_map[NUM_VIEWS][MAX_RENDER_TILES];
+static uint8_t scene_stored[NUM_VIEWS];       /* The view's code is complete */
+static uint16_t scene_store_start[NUM_VIEWS]; /* First byte of each view */
+static uint16_t scene_store_end[NUM_VIEWS];   /* One past its last byte */
+static uint16_t scene_store_used;             /* Bytes written */
+static uint8_t scene_last_tile[16];           /* Previous stored tile (repeat token) */
+static uint8_t scene_classified[NUM_VIEWS];   /* Map of the view is valid */
+
+#define NO_VIEW  0xFF
+
+/* View the tables point at (select_view); none at boot, so the first job
+ * of any view (also view 0) selects it */
+static uint8_t current_view = NO_VIEW;
+
+/* Views VRAM holds: one per bank 96x96, a full screen spans both */
+#if RENDER_BANK_ROWS == RENDER_TILES_Y
+#define VRAM_VIEWS  2
+#else
+#define VRAM_VIEWS  1
+#endif
+
+static uint8_t vram_view[2] = { NO_VIEW, NO_VIEW };  /* View in the render tiles of each VRAM bank */
+static uint8_t vram_shown_bank;                      /* VRAM bank the render area shows (96x96) */
+
+/* Per-view tables in ROM, selected by raytracer_set_view */
+static const view_luts_t *view = &view_luts[VIEW_FRONT];
+static const object_luts_t *object;          /* One of view->objects being traced */
+static const scanline_luts_t *scanline;      /* scanline_luts of the row being traced */
+
+/* Light of the current view and, under it, the shadow center of each object */
+static int16_t light_x;
+static int16_t light_z;
+static int16_t shadow_center_x[NUM_OBJECTS];
+static int16_t shadow_center_z[NUM_OBJECTS];
+
+/* Bins of the current view's tiles: bit i, the sphere of object i; bit
+ * 4 + i, its shadow (see OPTIMIZATION 13) */
+#define TILE_BIN_SPHERE(i)  ((uint8_t)(0x01 << (i)))
+#define TILE_BIN_SHADOW(i)  ((uint8_t)(0x10 << (i)))
+#define TILE_BIN_SPHERES    0x0F
+
+static uint8_t tile_bins[MAX_RENDER_TILES];
+
+/* A bit per tile of a tile row */
+#if RENDER_TILES_X > 16
+typedef uint32_t tile_row_mask_t;
+#else
+typedef uint16_t tile_row_mask_t;
+#endif
+
+#ifdef MOVING_LIGHT
+static int16_t view_light_x[NUM_VIEWS];       /* Light each view was last rendered with */
+static int16_t view_light_z[NUM_VIEWS];
+static tile_row_mask_t scene_detail[NUM_VIEWS][RENDER_TILES_Y];  /* Bit tx: a sphere or penumbra span touches the tile */
+#endif
+
+/*============================================================================
+ * OPTIMIZATIONS 1-6: PRECOMPUTED TABLES
+ * Sphere intersection LUTs, per-scanline ground/shadow terms, dx/dy arrays
+ * and the shadow brightness LUT are generated at build time (luts.h).
+ *============================================================================*/
+
+/*============================================================================
+ * DITHERING (ordered Bayer matrix, packed 8 pixels per byte)
+ * A pixel is bright when brightness > threshold[py][px]. Brightness is first
+ * quantized to a level (number of thresholds below it); each table entry is
+ * the bitplane byte of bright pixels for that level and row, so one AND with
+ * the pixel bit replaces the per-pixel compare and variable shift.
+ *============================================================================*/
+
+#ifdef DITHER_4X4
+
+/* 4x4 Bayer: thresholds 16 * { 0 8 2 10 / 12 4 14 6 / 3 11 1 9 / 15 7 13 5 } */
+#define DITHER_ROWS         4
+#define DITHER_LEVEL_SHIFT  4
+
+static const uint8_t dither_masks[DITHER_ROWS][17] = {
+    { 0x00, 0x88, 0x88, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xEE, 0xEE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x44, 0x44, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0xDD, 0xDD, 0xFF, 0xFF },
+    { 0x00, 0x00, 0x22, 0x22, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xBB, 0xBB, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x11, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x77, 0x77, 0xFF }
+};
+
+#else
+
+/* 2x2 Bayer: thresholds { 0 128 / 192 64 } */
+#define DITHER_ROWS         2
+#define DITHER_LEVEL_SHIFT  6
+
+static const uint8_t dither_masks[DITHER_ROWS][5] = {
+    { 0x00, 0xAA, 0xAA, 0xFF, 0xFF },
+    { 0x00, 0x00, 0x55, 0x55, 0xFF }
+};
+
+#endif
+
+#define DITHER_STEP         (1 << DITHER_LEVEL_SHIFT)
+#define DITHER_LEVEL(b)     ((uint8_t)(((uint16_t)(b) + DITHER_STEP - 1) >> DITHER_LEVEL_SHIFT))
+
+/* Brightness above the largest threshold always dithers to the bright color */
+#define DITHER_MAX_THRESHOLD (256 - DITHER_STEP)
+
+/*============================================================================
+ * RAY TRACING (OPTIMIZED)
+ *============================================================================*/
+
+/* OPTIMIZATION 3: Sphere LUT indices come from a build-time table folded
+ * around the screen center; fetch the row of scanline py once. Columns px
+ * here are the object's own (see find_sphere_span): W/2 is its center. */
+static const uint8_t *sphere_lut_row(uint8_t py) {
+    uint8_t ay = (py < RENDER_HEIGHT / 2) ? RENDER_HEIGHT / 2 - py : py - RENDER_HEIGHT / 2;
+    return sphere_lut_fold[ay];
+}
+
+static uint8_t sphere_lut_index(const uint8_t *lut_row, uint8_t px) {
+    COUNT_OP(OP_INDEX_LUT);
+    return lut_row[(px < RENDER_WIDTH / 2) ? RENDER_WIDTH / 2 - px : px - RENDER_WIDTH / 2];
+}
+
+static uint8_t sphere_hit_test(uint8_t lut_index) {
+    /* OPTIMIZATION 1: dist_sq = oc_sq - proj_sq < R^2 only depends on the
+     * LUT entry, and the entries that pass come first: genluts folds the
+     * whole test into lut_hit_end (no multiply, no division!) */
+    return lut_index < object->lut_hit_end;
+}
+
+static uint8_t shadow_lookup(int32_t shadow_dist_sq) {
+    /* OPTIMIZATION 4: Use shadow LUT (no division!) */
+    /* Clamp to valid range BEFORE casting to prevent overflow */
+    int16_t max_lut_value = (SHADOW_LUT_SIZE - 1) << SHADOW_LUT_SHIFT;
+    uint8_t lut_idx;
+    
+    if (shadow_dist_sq >= max_lut_value) {
+        lut_idx = SHADOW_LUT_SIZE - 1;  /* Far from shadow = full brightness */
+    } else if (shadow_dist_sq <= 0) {
+        lut_idx = 0;
+    } else {
+        lut_idx = (uint8_t)(shadow_dist_sq >> SHADOW_LUT_SHIFT);
+    }
+    
+    COUNT_OP(OP_SHADOW_LUT);
+    return shadow_brightness_lut[lut_idx];
+}
+
+/* (ground_z - shadow_center_z)^2 of object i's shadow on scanline py; no
+ * pixel of the scanline is in that shadow if it alone is lit, since
+ * shadow_dx_sq can only add to it */
+static int32_t shadow_dz_sq(uint8_t i, const scanline_luts_t *s) {
+    int16_t shadow_dz = s->t_ground - shadow_center_z[i];
+    return fx_mul16x16(shadow_dz, shadow_dz) >> FX8_SHIFT;
+}
+
+static uint8_t shadow_row_is_lit(int32_t dz_sq) {
+    return shadow_lookup(dz_sq) > DITHER_MAX_THRESHOLD;
+}
 
 /*============================================================================
- * SCENE STORAGE (2 views × 2304 bytes = 4608 bytes)
+ * OPTIMIZATION 16: LIGHT-SPECIALIZED LAMBERT KERNELS
+ * N.L = (nx * lx + ny * LIGHT_Y + nz * lz) >> 8 is the per-pixel multiply
+ * cost of sphere shading. The views bake the light at x = +-LIGHT_X,
+ * z = LIGHT_Z, which are +-FX8_HALF: LAMBERT_KERNEL expands the same source
+ * for each such side with the light as constants, and the x and z terms
+ * fold into one add and shift. Any other light (MOVING_LIGHT, LIGHT_SWEEP)
+ * takes the generic kernel. select_light picks the kernel.
  *============================================================================*/
 
-static uint8_t scene_buffer[NUM_VIEWS][SCENE_SIZE];
-static uint8_t tile_row_buffer[RENDER_TILES_X * 16];
+typedef int32_t (*lambert_fn)(int16_t nx, int16_t ny, int16_t nz);
+
+/* nx * lx + nz * lz for a constant light (lx, lz) */
+#define LIGHT_XZ_TERMS(nx, nz, lx, lz) \
+    (((lx) == FX8_HALF || (lx) == -FX8_HALF) && ((lz) == FX8_HALF || (lz) == -FX8_HALF) ? \
+        (int32_t)(((lx) > 0 ? (nx) : -(nx)) + ((lz) > 0 ? (nz) : -(nz))) << (FX8_SHIFT - 1) : \
+        fx_mul16x16((nx), (lx)) + fx_mul16x16((nz), (lz)))
+
+#define LAMBERT_KERNEL(name, lx, lz) \
+    static int32_t name(int16_t nx, int16_t ny, int16_t nz) { \
+        COUNT_OP(OP_MUL); \
+        return (LIGHT_XZ_TERMS(nx, nz, lx, lz) + fx_mul16x16(ny, LIGHT_Y)) >> FX8_SHIFT; \
+    }
+
+/* light_dir_x = -1 (VIEW_FRONT, VIEW_BACK) and +1 (the *_RIGHT views) */
+LAMBERT_KERNEL(lambert_light_left, -LIGHT_X, LIGHT_Z)
+LAMBERT_KERNEL(lambert_light_right, LIGHT_X, LIGHT_Z)
+
+static int32_t lambert_any(int16_t nx, int16_t ny, int16_t nz) {
+    COUNT_OP(OP_MUL);
+    COUNT_OP(OP_MUL);
+    COUNT_OP(OP_MUL);
+    return (fx_mul16x16(nx, light_x) + fx_mul16x16(ny, LIGHT_Y) + fx_mul16x16(nz, light_z)) >> FX8_SHIFT;
+}
+
+static lambert_fn lambert = lambert_any;
+
+static void select_lambert(int16_t lx, int16_t lz) {
+    if (lx == -LIGHT_X && lz == LIGHT_Z) {
+        lambert = lambert_light_left;
+    } else if (lx == LIGHT_X && lz == LIGHT_Z) {
+        lambert = lambert_light_right;
+    } else {
+        lambert = lambert_any;
+    }
+}
+
+#define SURFACE_SKY     0
+#define SURFACE_GROUND  1
+#define SURFACE_SPHERE  2
+
+/* Returns the surface hit by the ray through (px, py) of the current
+ * object, whose sphere LUT index is lut_index. Only sphere hits are shaded
+ * here (brightness_out); ground and sky come from the scanline passes. */
+static uint8_t trace_ray(uint8_t px, uint8_t py, uint8_t lut_index, uint8_t *brightness_out) {
+    COUNT_OP(OP_TRACE_RAY);
+    COUNT_OP(OP_SPHERE_LUT);
+    uint8_t hit_sphere = sphere_hit_test(lut_index);
+    int16_t t_hit = object->lut_t_hit[lut_index];
+    
+    /*=== SPHERE SHADING ===*/
+    /* OPTIMIZATION 2: Ground intersection from scanline precompute (no
+     * division!); a sky row's t_ground is beyond every t_hit */
+    if (hit_sphere && t_hit < scanline->t_ground) {
+        PROFILE_BEGIN(prof_start);
+        
+        /* dx_fp = RAY_STEP_FP * (px - W/2), so dx_fp * t_hit is a 16x8 product
+         * of the pixel offset and t_hit * RAY_STEP_FP; dz_fp = FX8_ONE */
+        COUNT_OP(OP_MUL);
+        int16_t t_step = t_hit * RAY_STEP_FP;
+        int8_t dx_px = (int8_t)(px - RENDER_WIDTH / 2);
+        int8_t dy_px = (int8_t)(RENDER_HEIGHT / 2 - py);
+        
+        int16_t hx = (int16_t)(fx_mul16x8(t_step, dx_px) >> FX8_SHIFT);
+        int16_t hy = (CAM_Y << FX8_SHIFT) + (int16_t)(fx_mul16x8(t_step, dy_px) >> FX8_SHIFT);
+        int16_t hz = t_hit;
+        
+        /* Normal = hit point - sphere center */
+        int16_t nx = hx;
+        int16_t ny = hy - (SPHERE_CY << FX8_SHIFT);
+        int16_t nz = hz - (object->cz << FX8_SHIFT);
+        nx >>= 1;
+        ny >>= 1;
+        nz >>= 1;
+        
+        /* Lambert shading, with the kernel of the light (OPTIMIZATION 16) */
+        int32_t dot = lambert(nx, ny, nz);
+        
+        int16_t brightness = 50;  /* Ambient */
+        if (dot > 0) {
+            brightness += FX8_MUL((int16_t)dot, 205);
+        }
+        if (brightness > 255) brightness = 255;
+        
+        *brightness_out = (uint8_t)brightness;
+        PROFILE_END(PROF_SPHERE, prof_start);
+        return SURFACE_SPHERE;
+    }
+    
+    /*=== GROUND SHADING: see walk_ground_scanline ===*/
+    return scanline->hit_ground ? SURFACE_GROUND : SURFACE_SKY;
+}
+
+/*============================================================================
+ * SCANLINE BITPLANES
+ *============================================================================*/
+
+/* The scanline's bitplane bytes go straight into its pixel row of each
+ * tile in tile_row_buffer: tile tx's pair is at scanline_row[tx * 16] */
+static uint8_t *scanline_row;
+
+/* Bits at and right of pixel (px & 7) within a bitplane byte */
+static const uint8_t span_mask_from[8] = {
+    0xFF, 0x7F, 0x3F, 0x1F, 0x0F, 0x07, 0x03, 0x01
+};
+
+static const uint8_t pixel_mask[8] = {
+    0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+};
+
+static void fill_span(uint8_t start, uint8_t end, uint8_t color) {
+    if (start >= end) return;
+    
+    uint8_t first = start >> 3;
+    uint8_t last = (end - 1) >> 3;
+    uint8_t *dst = &scanline_row[first * 16];
+    
+    for (uint8_t tx = first; tx <= last; tx++) {
+        uint8_t mask = 0xFF;
+        if (tx == first) mask &= span_mask_from[start & 7];
+        if (tx == last && (end & 7)) mask &= (uint8_t)~span_mask_from[end & 7];
+        
+        dst[0] = (dst[0] & ~mask) | ((color & 0x01) ? mask : 0);
+        dst[1] = (dst[1] & ~mask) | ((color & 0x02) ? mask : 0);
+        dst += 16;
+    }
+}
+
+/* Write dithered pixels into one bitplane byte pair: mask selects the pixels,
+ * bright the ones that take bright_color (the rest take dark_color) */
+static void blend_byte(uint8_t *dst, uint8_t mask, uint8_t bright,
+                       uint8_t dark_color, uint8_t bright_color) {
+    uint8_t dark = mask & ~bright;
+    bright &= mask;
+    
+    dst[0] = (dst[0] & ~mask) | ((bright_color & 0x01) ? bright : 0) | ((dark_color & 0x01) ? dark : 0);
+    dst[1] = (dst[1] & ~mask) | ((bright_color & 0x02) ? bright : 0) | ((dark_color & 0x02) ? dark : 0);
+}
+
+/*============================================================================
+ * OPTIMIZATION 7: SPAN EXTENTS (computed once per scanline)
+ *
+ * The sphere test only depends on dx_sq + dy_sq, which is symmetric around
+ * the object's center column, so each sphere covers one span
+ * [left, RENDER_WIDTH-left] in its columns, moved by object->shift on the
+ * screen, whose edge is found by binary search. Only sphere pixels are
+ * traced.
+ *============================================================================*/
+
+typedef struct {
+    uint8_t start;  /* First pixel of the span */
+    uint8_t end;    /* One past the last pixel (start == end: empty) */
+} span_t;
+
+/* Screen span of the current object on scanline py (clipped) */
+static void find_sphere_span(uint8_t py, span_t *span) {
+    const uint8_t *lut_row = sphere_lut_row(py);
+    uint8_t half_w = RENDER_WIDTH / 2;
+    
+    span->start = span->end = 0;
+    if (!sphere_hit_test(sphere_lut_index(lut_row, half_w))) return;
+    
+    /* Leftmost hit pixel: hits are contiguous up to the center column */
+    uint8_t lo = 0, hi = half_w;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) >> 1;
+        if (sphere_hit_test(sphere_lut_index(lut_row, mid))) hi = mid;
+        else lo = mid + 1;
+    }
+    
+    /* Mirror around the center: dx at (W - px) equals -dx at px */
+    int16_t start = (int16_t)lo + object->shift;
+    int16_t end = (int16_t)(RENDER_WIDTH - lo + 1) + object->shift;
+    
+    if (start < 0) start = 0;
+    if (end > RENDER_WIDTH) end = RENDER_WIDTH;
+    if (start < end) {
+        span->start = (uint8_t)start;
+        span->end = (uint8_t)end;
+    }
+}
+
+/*============================================================================
+ * OPTIMIZATION 9: FORWARD-DIFFERENCED GROUND WALK
+ * dx_fp * t_ground grows by a constant step along a scanline, so ground_x
+ * advances by q = step >> 8, or q + 1 when the low byte carries. shadow_dx^2
+ * is then updated from its previous value with additions only:
+ *   (d + k)^2 = d^2 + 2qd + k^2 (+ 2d when k = q + 1),  2q(d + k) = 2qd + 2qk
+ * Each shadow is walked only across its binned tiles, seeded at the first
+ * pixel: dx_fp * t_ground there is its px = 0 value plus px * step.
+ * Overlapping shadows keep the darker brightness.
+ *============================================================================*/
+
+#define ground_shade  (wram_arena.render.ground_shade)   /* Darkest shadow over each pixel */
+
+/* Darken ground_shade[start, end) with object i's shadow */
+static void walk_shadow(const scanline_luts_t *s, uint8_t i, uint8_t start, uint8_t end, int32_t dz_sq) {
+    uint16_t step = (uint16_t)s->ground_step;
+    uint8_t q = step >> 8;
+    uint8_t r = (uint8_t)step;
+    int32_t x = ((int32_t)s->ground_x0 << FX8_SHIFT) + s->ground_frac0 +
+                fx_mul16x8((int16_t)step, (int8_t)start);
+    uint8_t frac = (uint8_t)x;
+    int16_t shadow_dx = (int16_t)(x >> FX8_SHIFT) - shadow_center_x[i];
+    int32_t shadow_dx_sq = fx_mul16x16(shadow_dx, shadow_dx);
+    int32_t cross = fx_mul16x8(shadow_dx, (int8_t)q) << 1;
+    
+    /* Per-scanline increments for a q step and a (q + 1) step */
+    uint16_t q_sq = (uint16_t)q * q;
+    uint16_t q1_sq = q_sq + (q << 1) + 1;
+    uint16_t cross_q = q_sq << 1;
+    uint16_t cross_q1 = cross_q + (q << 1);
+    
+    for (uint8_t px = start; px < end; px++) {
+        uint8_t brightness = shadow_lookup((shadow_dx_sq >> FX8_SHIFT) + dz_sq);
+        if (brightness < ground_shade[px]) ground_shade[px] = brightness;
+        
+        /* Advance to px + 1 */
+        uint8_t next = frac + r;
+        if (next < frac) {
+            shadow_dx_sq += cross + (int16_t)(shadow_dx << 1) + q1_sq;
+            cross += cross_q1;
+            shadow_dx += q + 1;
+        } else {
+            shadow_dx_sq += cross + q_sq;
+            cross += cross_q;
+            shadow_dx += q;
+        }
+        frac = next;
+    }
+}
+
+/*============================================================================
+ * OPTIMIZATION 17: GROUND DITHER PACKING (ASM_KERNELS: SM83)
+ * The innermost loop of a shadowed ground scanline turns 8 ground_shade
+ * values into one bitplane byte. The C version is the reference (and the
+ * only one the host tools build); ASM_KERNELS=ON swaps in a hand-written
+ * SM83 loop that keeps the pointers in registers and computes the dither
+ * level with rotates: after the rounding add, carry holds bit 8, so
+ * 9 - DITHER_LEVEL_SHIFT rotates through carry leave the level in the low
+ * bits.
+ *============================================================================*/
+
+#ifdef ASM_KERNELS
+
+#ifdef DITHER_4X4
+#define DITHER_ASM_ROUND  15      /* DITHER_STEP - 1 */
+#define DITHER_ASM_MASK   0x1F    /* Bits 8-4 */
+#else
+#define DITHER_ASM_ROUND  63
+#define DITHER_ASM_MASK   0x07    /* Bits 8-6 */
+#endif
+
+/* sdcccall(1): shade in DE, levels in BC, result in A */
+static uint8_t dither_ground_byte(const uint8_t *shade, const uint8_t *levels) __naked __sdcccall(1) {
+    (void)shade;
+    (void)levels;
+    __asm
+        ld      h, d
+        ld      l, e                ; hl = shade
+        ld      d, b
+        ld      e, c                ; de = levels
+        ld      bc, #0x8000         ; b = pixel bit, c = bright pixels
+    1$:
+        ld      a, (hl+)
+        push    hl
+        add     a, #DITHER_ASM_ROUND
+        rla
+        rla
+        rla
+#ifdef DITHER_4X4
+        rla
+        rla
+#endif
+        and     a, #DITHER_ASM_MASK ; level
+        ld      l, a
+        ld      h, #0
+        add     hl, de
+        ld      a, (hl)             ; levels[level]
+        pop     hl
+        and     a, b
+        or      a, c
+        ld      c, a
+        srl     b
+        jr      nz, 1$
+        ld      a, c
+        ret
+    __endasm;
+}
+
+#else
+
+/* Bitplane byte of the 8 pixels shade[0-7]: bit set where the pixel
+ * dithers to the bright color of levels */
+static uint8_t dither_ground_byte(const uint8_t *shade, const uint8_t *levels) {
+    uint8_t bright = 0;
+    
+    for (uint8_t i = 0; i < 8; i++) {
+        bright |= levels[DITHER_LEVEL(shade[i])] & pixel_mask[i];
+    }
+    return bright;
+}
+
+#endif
+
+/* Walks the shadows over ground scanline py into ground_shade; tiles gets
+ * the tiles they cover (empty: all of it is solid lit ground) */
+static void walk_ground_scanline(uint8_t py, span_t *tiles) {
+    const scanline_luts_t *s = &scanline_luts[py];
+    const uint8_t *bins = &tile_bins[(py >> 3) * RENDER_TILES_X];
+    uint8_t first[NUM_OBJECTS], last[NUM_OBJECTS];  /* Binned tiles of each shadow, [first, last) */
+    int32_t dz_sq[NUM_OBJECTS];
+    uint8_t lo = RENDER_TILES_X, hi = 0;            /* All of them */
+    
+    tiles->start = tiles->end = 0;
+    
+    for (uint8_t i = 0; i < NUM_OBJECTS; i++) {
+        uint8_t bit = TILE_BIN_SHADOW(i);
+        uint8_t a = 0, b = RENDER_TILES_X;
+        
+        first[i] = last[i] = 0;
+        while (a < b && !(bins[a] & bit)) a++;
+        if (a == b) continue;
+        while (!(bins[b - 1] & bit)) b--;
+        
+        dz_sq[i] = shadow_dz_sq(i, s);
+        if (shadow_row_is_lit(dz_sq[i])) continue;
+        
+        first[i] = a;
+        last[i] = b;
+        if (a < lo) lo = a;
+        if (b > hi) hi = b;
+    }
+    
+    if (lo >= hi) return;
+    
+    memset(&ground_shade[lo << 3], 255, (hi - lo) << 3);
+    for (uint8_t i = 0; i < NUM_OBJECTS; i++) {
+        if (last[i]) walk_shadow(s, i, first[i] << 3, last[i] << 3, dz_sq[i]);
+    }
+    tiles->start = lo;
+    tiles->end = hi;
+}
+
+/* Ground scanline py into scanline_row: the walked tiles dithered, the
+ * others solid lit ground */
+static void pack_ground_scanline(uint8_t py, const span_t *tiles) {
+    const uint8_t *levels = dither_masks[py & (DITHER_ROWS - 1)];
+    
+    if (tiles->start >= tiles->end) {
+        fill_span(0, RENDER_WIDTH, COLOR_GROUND);
+        return;
+    }
+    fill_span(0, tiles->start << 3, COLOR_GROUND);
+    fill_span(tiles->end << 3, RENDER_WIDTH, COLOR_GROUND);
+    
+    for (uint8_t tx = tiles->start; tx < tiles->end; tx++) {
+        uint8_t bright = dither_ground_byte(&ground_shade[tx << 3], levels);
+        blend_byte(&scanline_row[tx * 16], 0xFF, bright, COLOR_SHADOW, COLOR_GROUND);
+    }
+}
+
+/* Pixels of the walked tiles that are not solid lit ground */
+static void ground_penumbra(const span_t *tiles, span_t *penumbra) {
+    penumbra->start = penumbra->end = 0;
+    if (tiles->start >= tiles->end) return;
+    
+    penumbra->start = RENDER_WIDTH;
+    for (uint8_t px = tiles->start << 3; px < (uint8_t)(tiles->end << 3); px++) {
+        if (ground_shade[px] <= DITHER_MAX_THRESHOLD) {
+            if (penumbra->start == RENDER_WIDTH) penumbra->start = px;
+            penumbra->end = px + 1;
+        }
+    }
+    if (penumbra->end == 0) penumbra->start = 0;
+}
+
+/*============================================================================
+ * OPTIMIZATION 13: SCENE OBJECTS AND TILE BINS
+ * A view has NUM_OBJECTS spheres (SCENE_OBJECTS), in ROM far to near, each
+ * with its own intersection LUTs. The image of a sphere beside the view
+ * axis is taken to be the one of a sphere straight ahead at its depth,
+ * moved to the column its center projects to: the same folded LUT index
+ * and division-free test, and exact in depth and at the horizon, where
+ * the centers are. Drawn far to near, nearer spheres cover farther ones.
+ * Each sphere's and shadow's bounding box is put into bins on the tile
+ * grid per view: a scanline only tests the spheres binned to its tiles and
+ * walks each shadow across its binned tiles, so the work follows the
+ * pixels objects cover instead of objects x pixels.
+ *============================================================================*/
+
+/* Objects whose sphere is binned to a tile of tile row ty */
+static uint8_t row_spheres(uint8_t ty) {
+    const uint8_t *bins = &tile_bins[ty * RENDER_TILES_X];
+    uint8_t spheres = 0;
+    
+    for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) spheres |= bins[tx];
+    return spheres & TILE_BIN_SPHERES;
+}
+
+/* Column whose ground hit on scanline py is at x (rounded down, may be off
+ * screen): a multiply by the scanline's columns per unit, no division */
+static int16_t ground_column(const scanline_luts_t *s, int16_t x) {
+    return (int16_t)(fx_mul16x16(x - s->ground_x0, s->px_per_x) >> 16);
+}
+
+/* Spheres: the tiles found at build time. Shadows: on each scanline not
+ * lit, the tiles within SPHERE_R of the center in x, one column of margin
+ * on each side for the rounding. Shadows move with the light, so the bins
+ * are rebuilt with it. */
+static void bin_objects(void) {
+    memset(tile_bins, 0, MAX_RENDER_TILES);
+    
+    for (uint8_t i = 0; i < NUM_OBJECTS; i++) {
+        const object_luts_t *o = &view->objects[i];
+        
+        for (uint8_t ty = o->tile_y0; ty <= o->tile_y1; ty++) {
+            for (uint8_t tx = o->tile_x0; tx <= o->tile_x1; tx++) {
+                tile_bins[ty * RENDER_TILES_X + tx] |= TILE_BIN_SPHERE(i);
+            }
+        }
+        
+        for (uint8_t py = 0; py < RENDER_HEIGHT; py++) {
+            const scanline_luts_t *s = &scanline_luts[py];
+            if (!s->hit_ground || shadow_row_is_lit(shadow_dz_sq(i, s))) continue;
+            
+            int16_t lo = ground_column(s, shadow_center_x[i] - (SPHERE_R << FX8_SHIFT)) - 1;
+            int16_t hi = ground_column(s, shadow_center_x[i] + (SPHERE_R << FX8_SHIFT)) + 1;
+            if (hi < 0 || lo >= RENDER_WIDTH) continue;
+            if (lo < 0) lo = 0;
+            if (hi >= RENDER_WIDTH) hi = RENDER_WIDTH - 1;
+            
+            uint8_t *bins = &tile_bins[(py >> 3) * RENDER_TILES_X];
+            for (uint8_t tx = (uint8_t)lo >> 3; tx <= (uint8_t)hi >> 3; tx++) {
+                bins[tx] |= TILE_BIN_SHADOW(i);
+            }
+        }
+    }
+}
+
+/*============================================================================
+ * OPTIMIZATION 8: TILE CLASSIFICATION (once per view)
+ * A tile whose 8 scanlines are all sky, or all ground, and that no sphere
+ * or penumbra span touches renders to a constant pattern. Its map entry
+ * points at a shared tile instead, so it is never traced, stored or uploaded.
+ *============================================================================*/
+
+#define TILE_SEEN_SKY     0x01
+#define TILE_SEEN_GROUND  0x02
+#define TILE_SEEN_DETAIL  0x04
+
+static void mark_span(uint8_t *flags, const span_t *span) {
+    if (span->start >= span->end) return;
+    for (uint8_t tx = span->start >> 3; tx <= (uint8_t)((span->end - 1) >> 3); tx++) {
+        flags[tx] |= TILE_SEEN_DETAIL;
+    }
+}
+
+static uint8_t is_mixed_tile(uint8_t map_entry) {
+    return map_entry != RENDER_TILE_SKY && map_entry != RENDER_TILE_GROUND;
+}
+
+/* What scanline py of the current view shows in each tile, added to flags */
+static void classify_scanline(uint8_t py, uint8_t *flags) {
+    uint8_t spheres = row_spheres(py >> 3);
+    uint8_t hit_ground = scanline_luts[py].hit_ground;
+    uint8_t seen = hit_ground ? TILE_SEEN_GROUND : TILE_SEEN_SKY;
+    span_t span;
+    
+    for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) flags[tx] |= seen;
+    
+    for (uint8_t i = 0; i < NUM_OBJECTS; i++) {
+        if (!(spheres & TILE_BIN_SPHERE(i))) continue;
+        object = &view->objects[i];
+        find_sphere_span(py, &span);
+        mark_span(flags, &span);
+    }
+    if (hit_ground) {
+        span_t tiles;
+        
+        walk_ground_scanline(py, &tiles);
+        ground_penumbra(&tiles, &span);
+        mark_span(flags, &span);
+    }
+}
+
+/* Map entries of tile row ty from the flags of its 8 scanlines */
+static void classify_store(uint8_t view_id, uint8_t ty, const uint8_t *flags) {
+    uint8_t *map_row = &scene_map[view_id][ty * RENDER_TILES_X];
+    
+#ifdef MOVING_LIGHT
+    scene_detail[view_id][ty] = 0;
+#endif
+    for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
+        if (flags[tx] == TILE_SEEN_SKY) {
+            map_row[tx] = RENDER_TILE_SKY;
+        } else if (flags[tx] == TILE_SEEN_GROUND) {
+            map_row[tx] = RENDER_TILE_GROUND;
+        } else {
+            map_row[tx] = RENDER_ROW_TILE(ty) + tx;
+        }
+#ifdef MOVING_LIGHT
+        if (flags[tx] & TILE_SEEN_DETAIL) scene_detail[view_id][ty] |= (tile_row_mask_t)1 << tx;
+#endif
+    }
+}
+
+/* Map entries of tile row ty of the current view */
+static void classify_row(uint8_t view_id, uint8_t ty) {
+    uint8_t flags[RENDER_TILES_X];
+    
+    memset(flags, 0, RENDER_TILES_X);
+    for (uint8_t row = 0; row < 8; row++) {
+        classify_scanline(ty * 8 + row, flags);
+    }
+    classify_store(view_id, ty, flags);
+}
+
+static void classify_tiles(uint8_t view_id) {
+    for (uint8_t ty = 0; ty < RENDER_TILES_Y; ty++) {
+        classify_row(view_id, ty);
+    }
+    scene_classified[view_id] = 1;
+}
+
+/*============================================================================
+ * CAMERA SETUP
+ *============================================================================*/
+
+/* Sphere shading uses the light directly; each shadow center is the
+ * sphere's center moved along it down to the ground */
+static void select_light(int16_t lx, int16_t lz) {
+    int16_t offset_x = FX8_MUL(-lx, SHADOW_T_FP);
+    int16_t offset_z = FX8_MUL(-lz, SHADOW_T_FP);
+    
+    light_x = lx;
+    light_z = lz;
+    select_lambert(lx, lz);
+    for (uint8_t i = 0; i < NUM_OBJECTS; i++) {
+        shadow_center_x[i] = view->objects[i].cx + offset_x;
+        shadow_center_z[i] = (view->objects[i].cz << FX8_SHIFT) + offset_z;
+    }
+    bin_objects();
+}
+
+/* Tables and light of view_id; its tiles may not be classified yet */
+static void select_view(uint8_t view_id) {
+    /* All view-dependent tables are in ROM: switching is a pointer swap */
+    SWITCH_ROM(BANK(raytracer_luts));
+    view = &view_luts[view_id];
+    current_view = view_id;
+#ifdef MOVING_LIGHT
+    select_light(view_light_x[view_id], view_light_z[view_id]);
+#else
+    select_light(view->light_dir_x * LIGHT_X, view->light_dir_z * LIGHT_Z);
+#endif
+}
+
+void raytracer_set_view(uint8_t view_id) {
+    select_view(view_id);
+    
+    /* OPTIMIZATION 8: Find uniform tiles of this view (first visit only) */
+    if (!scene_classified[view_id]) {
+        classify_tiles(view_id);
+    }
+}
+
+/*============================================================================
+ * OPTIMIZATION 11: EDGE-ADAPTIVE SPHERE SAMPLING
+ * Within a sphere span, trace_ray is only called every SAMPLE_STEP pixels
+ * and, recursively, halfway between two samples that differ. If both ends
+ * of a run have the same LUT index and the same result, every pixel between
+ * has too, so the run is filled without tracing:
+ * - lut_index falls with |dx| (d_dot_d), so it is constant across the run
+ *   as long as the run does not cross the center column, which is always
+ *   a sample (a multiple of SAMPLE_STEP)
+ * - with a constant lut_index the surface is fixed, and brightness is a
+ *   monotonic function of px (only hx varies, linearly), so its dither
+ *   level cannot leave and come back
+ * The result is exact: the same dithered pixels as tracing every pixel.
+ * Spans are sampled in the object's columns, where its center is W/2.
+ *============================================================================*/
+
+#define SAMPLE_STEP  8
+
+#define sample_lut    (wram_arena.render.sample_lut)    /* LUT index of traced pixels */
+#define sample_level  (wram_arena.render.sample_level)  /* 0: not sphere, else dither level + 1 */
+static const uint8_t *sample_lut_row;        /* sphere_lut_row of the span's scanline */
+
+static void sample_pixel(uint8_t px, uint8_t py) {
+    uint8_t brightness;
+    uint8_t lut_index = sphere_lut_index(sample_lut_row, px);
+    
+    sample_lut[px] = lut_index;
+    sample_level[px] = (trace_ray(px, py, lut_index, &brightness) == SURFACE_SPHERE)
+                       ? DITHER_LEVEL(brightness) + 1 : 0;
+}
+
+/* Fill the pixels strictly between the samples a and b */
+static void refine_samples(uint8_t a, uint8_t b, uint8_t py) {
+    if (b - a < 2) return;
+    
+    if (sample_lut[a] == sample_lut[b] && sample_level[a] == sample_level[b]) {
+        memset(&sample_level[a + 1], sample_level[a], b - a - 1);
+        return;
+    }
+    
+    uint8_t mid = (a + b) >> 1;
+    sample_pixel(mid, py);
+    refine_samples(a, mid, py);
+    refine_samples(mid, b, py);
+}
+
+static void sample_sphere_span(uint8_t start, uint8_t end, uint8_t py) {
+    uint8_t last = end - 1;
+    uint8_t a = start;
+    
+    sample_lut_row = sphere_lut_row(py);
+    scanline = &scanline_luts[py];
+    sample_pixel(a, py);
+    while (a < last) {
+        /* Next multiple of SAMPLE_STEP, or the end of the span */
+        uint8_t b = (a | (SAMPLE_STEP - 1)) + 1;
+        if (b > last) b = last;
+        
+        sample_pixel(b, py);
+        refine_samples(a, b, py);
+        a = b;
+    }
+}
+
+/*============================================================================
+ * TILE GENERATION & STORAGE
+ *============================================================================*/
+
+/* Shade the current object's pixels of [start, end) a byte at a time;
+ * pixels where the ground is in front keep what was drawn before */
+static void shade_sphere_span(uint8_t start, uint8_t end, uint8_t py) {
+    const uint8_t *levels = dither_masks[py & (DITHER_ROWS - 1)];
+    uint8_t shift = (uint8_t)object->shift;
+    uint8_t px = start;
+    
+    if (start >= end) return;
+    sample_sphere_span(start - shift, end - shift, py);
+    
+    PROFILE_BEGIN(prof_start);
+    while (px < end) {
+        uint8_t tx = px >> 3;
+        uint8_t byte_end = (tx + 1) << 3;
+        uint8_t sphere_mask = 0, sphere_bright = 0;
+        
+        if (byte_end > end) byte_end = end;
+        
+        for (; px < byte_end; px++) {
+            uint8_t level = sample_level[(uint8_t)(px - shift)];
+            
+            if (level) {
+                uint8_t bit = pixel_mask[px & 7];
+                sphere_mask |= bit;
+                sphere_bright |= levels[level - 1] & bit;
+            }
+        }
+        
+        if (sphere_mask) {
+            blend_byte(&scanline_row[tx * 16], sphere_mask, sphere_bright, COLOR_SHADOW, COLOR_SPHERE);
+        }
+    }
+    PROFILE_END(PROF_PACK, prof_start);
+}
+
+static void render_ground_scanline(uint8_t py) {
+    span_t tiles;
+    PROFILE_BEGIN(prof_start);
+    
+    walk_ground_scanline(py, &tiles);
+    
+    PROFILE_END(PROF_GROUND, prof_start);
+    PROFILE_BEGIN(pack_start);
+    
+    pack_ground_scanline(py, &tiles);
+    
+    PROFILE_END(PROF_PACK, pack_start);
+}
+
+void raytracer_render_row(uint8_t tile_row) {
+    uint8_t base_py = tile_row * 8;
+    
+    for (uint8_t row = 0; row < 8; row++) {
+        raytracer_render_scanline(base_py + row);
+    }
+}
+
+/*============================================================================
+ * SCANLINE-BY-SCANLINE RENDERING (smoother visual feedback)
+ *============================================================================*/
+
+#ifdef PROGRESSIVE
+
+/* OPTIMIZATION 10: PROGRESSIVE PASSES
+ * Scanlines are interlaced: every 8th first, then the ones halfway between,
+ * down to the odd ones. Each scanline is traced exactly once and copied
+ * into the rows below it that no pass has reached yet, i.e. up to the next
+ * multiple of its lowest set bit (8 for py % 8 == 0). The first pass is an
+ * 8x-stretched picture after 1/8 of the work; the last one is the normal
+ * full-resolution image. */
+#define SCANLINE_FILL_ROWS(py)  ((uint8_t)(((py) | 8) & -((py) | 8)))
+
+/* Passes: py = 0, 8, ...; 4, 12, ...; 2, 6, ...; 1, 3, ... */
+static const uint8_t pass_first[4] = { 0, 4, 2, 1 };
+static const uint8_t pass_step[4]  = { 8, 8, 4, 2 };
+
+uint8_t raytracer_progressive_scanline(uint8_t i) {
+    uint8_t pass = 0;
+    
+    while (i >= RENDER_HEIGHT / pass_step[pass]) {
+        i -= RENDER_HEIGHT / pass_step[pass];
+        pass++;
+    }
+    return pass_first[pass] + i * pass_step[pass];
+}
+
+static void select_tile_row(uint8_t py) {
+    /* New view: every row's buffer starts clear */
+    if (py == 0) {
+        upload_queue_flush();
+        memset(tile_row_buffers[0], 0, TILE_ROW_BUFFERS * TILE_ROW_SIZE);
+    }
+    tile_row_index = py >> 3;
+    tile_row_buffer = tile_row_buffers[tile_row_index];
+}
+
+#else
+
+#define SCANLINE_FILL_ROWS(py)  1
+
+/* Switch buffers and clear at start of each tile row */
+static void select_tile_row(uint8_t py) {
+    if ((py & 7) == 0) {
+        tile_row_index ^= 1;
+        tile_row_buffer = tile_row_buffers[tile_row_index];
+        upload_queue_wait(tile_row_tickets[tile_row_index]);
+        memset(tile_row_buffer, 0, TILE_ROW_SIZE);
+    }
+}
+
+#endif
+
+void raytracer_render_scanline(uint8_t py) {
+    span_t sphere;
+    uint8_t spheres = row_spheres(py >> 3);
+    
+    select_tile_row(py);
+    scanline_row = &tile_row_buffer[(py & 7) * 2];
+    
+    /* OPTIMIZATION 7/9: Fill or walk the background, trace only the sphere
+     * spans of the objects binned to this tile row (OPTIMIZATION 13) */
+    if (scanline_luts[py].hit_ground) {
+        render_ground_scanline(py);
+    } else {
+        PROFILE_BEGIN(prof_start);
+        fill_span(0, RENDER_WIDTH, COLOR_SKY);
+        PROFILE_END(PROF_PACK, prof_start);
+    }
+    
+    for (uint8_t i = 0; i < NUM_OBJECTS; i++) {
+        if (!(spheres & TILE_BIN_SPHERE(i))) continue;
+        object = &view->objects[i];
+        find_sphere_span(py, &sphere);
+        shade_sphere_span(sphere.start, sphere.end, py);
+    }
+    
+    /* A coarse pass stretches the scanline over the rows below it (mixed
+     * tiles only: the others are not stored) */
+    PROFILE_BEGIN(prof_start);
+    uint8_t fill_rows = SCANLINE_FILL_ROWS(py);
+    if (fill_rows > 1) {
+        const uint8_t *map = &scene_map[current_view][(py >> 3) * RENDER_TILES_X];
+        for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
+            if (!is_mixed_tile(map[tx])) continue;
+            uint8_t *dst = &scanline_row[tx * 16];
+            for (uint8_t r = 1; r < fill_rows; r++) {
+                dst[r * 2] = dst[0];
+                dst[r * 2 + 1] = dst[1];
+            }
+        }
+    }
+    PROFILE_END(PROF_PACK, prof_start);
+}
+
+/* Only the scanline's row of each tile changed: queue those 2 bytes per
+ * tile (24 instead of 192 per scanline), read from tile_row_buffer, which
+ * stays untouched until its ticket has passed. Writes cover the first to
+ * the last mixed tile; slots of uniform tiles in between are not shown. */
+void raytracer_upload_scanline(uint8_t py) {
+    /* A coarse pass wrote several rows of each tile: send the whole row */
+    if (SCANLINE_FILL_ROWS(py) > 1) {
+        raytracer_upload_row(py >> 3);
+        return;
+    }
+    
+    const uint8_t *map = &scene_map[current_view][(py >> 3) * RENDER_TILES_X];
+    uint8_t first = 0, last = RENDER_TILES_X;
+    
+    while (first < RENDER_TILES_X && !is_mixed_tile(map[first])) first++;
+    if (first == RENDER_TILES_X) return;
+    while (!is_mixed_tile(map[last - 1])) last--;
+    
+    uint8_t ty = py >> 3;
+    uint8_t row_in_tile = py & 7;
+    tile_row_tickets[tile_row_index] =
+        upload_queue_scanline(RENDER_ROW_BANK(ty), RENDER_ROW_TILE(ty) + first, last - first,
+                              row_in_tile, &tile_row_buffer[first * 16 + row_in_tile * 2]);
+}
 
-/* Current view affects light direction and sphere distance */
-static int8_t light_dir_x = -1;  /* -1 for front (left), +1 for back (right) */
-static int8_t light_dir_z = 1;
-static int16_t sphere_cz = SPHERE_CZ;  /* View-dependent: 6 for close, 12 for far */
+/* Queue the whole tile row for the VBlank handler as one DMA job. Uniform
+ * tiles' slots go along (the map does not show them). */
+void raytracer_upload_row(uint8_t tile_row) {
+    tile_row_tickets[tile_row_index] =
+        upload_queue_tiles(RENDER_ROW_BANK(tile_row), RENDER_ROW_TILE(tile_row), RENDER_TILES_X, tile_row_buffer);
+}
 
 /*============================================================================
- * OPTIMIZATION 1: LOOKUP TABLES FOR SPHERE INTERSECTION
- * d_dot_d ranges from ~256 to ~706 based on screen coordinates
- * Use 64-entry quantized LUT to save memory (GBC only has 8KB WRAM!)
+ * OPTIMIZATION 14: BACKGROUND RENDERING
+ * A view can also be traced a scanline at a time between other work. Its
+ * rows go through the tile row buffers into the scene store as usual, but
+ * nothing is uploaded, so the picture on screen stays as it is;
+ * raytracer_load_scene shows the view once it is done. The store keeps a
+ * view's rows together, so anything else that renders (a relight) finishes
+ * the job first. With LINK_CABLE the rows are shared with a second unit
+ * (OPTIMIZATION 18).
+ * Each step stays short of a frame, so the caller can fit steps between
+ * frames: selecting a view (bin_objects goes over every scanline) is a
+ * step of its own, and a view not classified yet gets one scanline of
+ * OPTIMIZATION 8 per step before any is traced.
  *============================================================================*/
 
-#define LUT_MIN_VAL   256
-#define LUT_MAX_VAL   768
-#define LUT_SHIFT     3       /* Divide d_dot_d range by 8 */
-#define LUT_SIZE      64      /* (768-256)/8 = 64 entries */
+static uint8_t background_view = NO_VIEW;   /* View of the job, NO_VIEW: none */
+static uint8_t background_py;               /* Its next scanline */
+static uint8_t background_classify_py;      /* Next scanline to classify */
+static uint8_t background_flags[RENDER_TILES_X];  /* classify_scanline of its tile row so far */
 
-/* LUT for t_hit = (oc_dot_d << FX8_SHIFT) / d_dot_d */
-static int16_t lut_t_hit[LUT_SIZE];
+#ifdef LINK_CABLE
+#define NO_ROW  0xFF
 
-/* LUT for proj_sq = (oc_dot_d * oc_dot_d) / d_dot_d */
-static int16_t lut_proj_sq[LUT_SIZE];  /* Use int16_t to save memory */
+static uint8_t background_stored;           /* Rows stored, in order */
+static uint8_t background_own = NO_ROW;     /* Row this unit traces */
+static uint8_t background_held = NO_ROW;    /* Own row traced ahead of the store */
+static const uint8_t *background_held_tiles;
+static uint8_t background_dealt[RENDER_TILES_Y];  /* Rows with the partner */
+#endif
 
-/* oc_dot_d is constant because oc_y_fp = 0 (cam and sphere same Y) */
-static int16_t oc_dot_d_constant;
+void raytracer_background_begin(uint8_t view_id) {
+    background_view = view_id;
+    background_py = 0;
+    background_classify_py = 0;
+#ifdef LINK_CABLE
+    /* Row 0 is always this unit's, so no row is held when PROGRESSIVE
+     * clears the buffers at py == 0 */
+    background_stored = 0;
+    background_own = 0;
+    background_held = NO_ROW;
+    memset(background_dealt, 0, RENDER_TILES_Y);
+#endif
+}
 
-/*============================================================================
- * OPTIMIZATION 2: PER-SCANLINE PRECOMPUTED GROUND INTERSECTION
- *============================================================================*/
+uint8_t raytracer_background_progress(void) {
+#ifdef LINK_CABLE
+    return background_stored << 3;
+#else
+    return background_py;
+#endif
+}
 
-static int16_t scanline_dy_fp[RENDER_HEIGHT];
-static int16_t scanline_t_ground[RENDER_HEIGHT];
-static uint8_t scanline_hit_ground[RENDER_HEIGHT];
+/* The first steps of a job: select the view again if scanlines of another
+ * one were rendered in between, then classify it. Returns 0 once the job
+ * can trace. */
+static uint8_t background_prepare(void) {
+    if (current_view != background_view) {
+        select_view(background_view);
+        return 1;
+    }
+    if (scene_classified[background_view]) return 0;
+    
+    uint8_t py = background_classify_py++;
+    if ((py & 7) == 0) memset(background_flags, 0, RENDER_TILES_X);
+    classify_scanline(py, background_flags);
+    if ((py & 7) == 7) classify_store(background_view, py >> 3, background_flags);
+    if (background_classify_py == RENDER_HEIGHT) scene_classified[background_view] = 1;
+    return 1;
+}
 
-/*============================================================================
- * OPTIMIZATION 3: PRECOMPUTED DX/DY ARRAYS
- *============================================================================*/
+#ifndef LINK_CABLE
+uint8_t raytracer_background_step(void) {
+    if (background_view == NO_VIEW) return 0;
+    if (background_prepare()) return 1;
+    
+    raytracer_render_scanline(background_py);
+    if ((background_py & 7) == 7) {
+        raytracer_store_row(background_view, background_py >> 3);
+    }
+    
+    if (++background_py == RENDER_HEIGHT) background_view = NO_VIEW;
+    return background_view != NO_VIEW;
+}
+#endif
 
-static int16_t dx_fp_array[RENDER_WIDTH];
-static int32_t dx_sq_array[RENDER_WIDTH];
-static int16_t dy_fp_array[RENDER_HEIGHT];
-static int32_t dy_sq_array[RENDER_HEIGHT];
-static int32_t dz_sq_constant;
+void raytracer_background_finish(void) {
+    while (raytracer_background_step()) {
+    }
+}
 
 /*============================================================================
- * OPTIMIZATION 4: SHADOW BRIGHTNESS LUT
- * Maps shadow_dist_sq directly to brightness (0-255) with no division!
- * Range: 0 to ~1200 (sphere_radius_sq << 8), quantized to 128 entries
+ * SCENE COMPRESSION
+ * Dithered tiles repeat every 2 rows, so each tile is stored as a 16-bit
+ * mask followed by the bytes that differ from their reference: the same
+ * bitplane byte 2 rows up (row 1: 1 row up, row 0: 0xFF). A zero mask
+ * repeats the previous tile of the view. Rows of a view must be stored in
+ * order; a load decodes them one tile at a time.
+ * A view re-rendered after a later one was stored is appended again.
  *============================================================================*/
 
-#define SHADOW_LUT_SIZE   128
-#define SHADOW_LUT_SHIFT  3     /* Divide shadow_dist_sq by 8 for indexing */
+#define TILE_CODE_MAX        18   /* Mask + 16 literal bytes */
 
-static uint8_t shadow_brightness_lut[SHADOW_LUT_SIZE];
+static uint8_t encode_tile(const uint8_t *tile, uint8_t *out) {
+    uint16_t mask = 0, bit = 1;
+    uint8_t n = 2;
+    
+    for (uint8_t i = 0; i < 16; i++) {
+        uint8_t ref = (i >= 4) ? tile[i - 4] : (i >= 2) ? tile[i - 2] : 0xFF;
+        if (tile[i] != ref) {
+            mask |= bit;
+            out[n++] = tile[i];
+        }
+        bit <<= 1;
+    }
+    
+    /* An all-0xFF tile must not look like the repeat token */
+    if (!mask) {
+        mask = 1;
+        out[n++] = 0xFF;
+    }
+    
+    out[0] = (uint8_t)mask;
+    out[1] = (uint8_t)(mask >> 8);
+    return n;
+}
 
-/*============================================================================
- * OPTIMIZATION 5: SHADOW CONSTANTS (precomputed per view)
- * Removes ALL per-pixel divisions from shadow calculation!
- *============================================================================*/
+/* Decode one tile into tile (which holds the previous tile for a repeat) */
+static const uint8_t *decode_tile(const uint8_t *src, uint8_t *tile) {
+    uint16_t mask = src[0] | ((uint16_t)src[1] << 8);
+    uint16_t bit = 1;
+    
+    src += 2;
+    if (!mask) return src;
+    
+    for (uint8_t i = 0; i < 16; i++) {
+        if (mask & bit) {
+            tile[i] = *src++;
+        } else {
+            tile[i] = (i >= 4) ? tile[i - 4] : (i >= 2) ? tile[i - 2] : 0xFF;
+        }
+        bit <<= 1;
+    }
+    return src;
+}
 
-static int16_t shadow_center_x_const;  /* Shadow center X (view-dependent) */
-static int16_t shadow_center_z_const;  /* Shadow center Z (view-dependent) */
+/* Copy n bytes between bank 0 (or SRAM) and the store at pos; a copy
+ * that runs past the end of a WRAM bank goes on at the start of the next */
+static void store_copy(uint16_t pos, uint8_t *mem, uint16_t n, uint8_t to_store) {
+    uint8_t saved_bank = SVBK_REG;
+    
+    while (n) {
+        uint16_t offset = pos & (SCENE_WRAM_BANK_SIZE - 1);
+        uint16_t chunk = SCENE_WRAM_BANK_SIZE - offset;
+        if (chunk > n) chunk = n;
+        
+        SVBK_REG = SCENE_WRAM_FIRST_BANK + pos / SCENE_WRAM_BANK_SIZE;
+        if (to_store) {
+            memcpy(WRAMX_BASE + offset, mem, chunk);
+        } else {
+            memcpy(mem, WRAMX_BASE + offset, chunk);
+        }
+        pos += chunk;
+        mem += chunk;
+        n -= chunk;
+    }
+    SVBK_REG = saved_bank;
+}
 
-/*============================================================================
- * OPTIMIZATION 6: PER-SCANLINE SHADOW TERMS
- * shadow_dz only depends on py, so precompute per scanline
- *============================================================================*/
+/* Start storing a view after the last one */
+static void begin_stored_view(uint8_t view_id) {
+    /* Stored last: overwrite it in place */
+    if (scene_stored[view_id] && scene_store_end[view_id] == scene_store_used) {
+        scene_store_used = scene_store_start[view_id];
+    }
+    
+    scene_stored[view_id] = 1;
+    scene_store_start[view_id] = scene_store_end[view_id] = scene_store_used;
+    memset(scene_last_tile, 0xFF, 16);
+}
 
-static int16_t scanline_ground_z[RENDER_HEIGHT];      /* ground_z for each scanline */
-static int32_t scanline_shadow_dz_sq[RENDER_HEIGHT];  /* (ground_z - shadow_center_z)^2 */
+/* Append one tile of view_id; 0 once the view is dropped */
+static uint8_t store_tile(uint8_t view_id, const uint8_t *tile) {
+    uint8_t code[TILE_CODE_MAX];
+    uint8_t n;
+    
+    if (memcmp(tile, scene_last_tile, 16) == 0) {
+        code[0] = code[1] = 0;
+        n = 2;
+    } else {
+        n = encode_tile(tile, code);
+        memcpy(scene_last_tile, tile, 16);
+    }
+    
+    /* Out of WRAM banks: the view is not stored */
+    if (n > SCENE_STORE_SIZE - scene_store_used) {
+        scene_stored[view_id] = 0;
+        scene_store_used = scene_store_start[view_id];
+        return 0;
+    }
+    
+    store_copy(scene_store_used, code, n, 1);
+    scene_store_used += n;
+    scene_store_end[view_id] = scene_store_used;
+    return 1;
+}
 
-/*============================================================================
- * DITHERING (2x2 Bayer matrix)
- *============================================================================*/
+/* Store the mixed tiles of a rendered tile row (tiles: TILE_ROW_SIZE
+ * bytes, in map order) */
+static void store_tiles(uint8_t view_id, uint8_t tile_row, const uint8_t *tiles) {
+    const uint8_t *map = &scene_map[view_id][tile_row * RENDER_TILES_X];
+    
+    if (tile_row == 0) begin_stored_view(view_id);
+    if (!scene_stored[view_id]) return;
+    
+    for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
+        if (is_mixed_tile(map[tx]) && !store_tile(view_id, &tiles[tx * 16])) return;
+    }
+}
 
-static const uint8_t bayer2x2[2][2] = {
-    {  0, 128 },
-    { 192,  64 }
-};
+void raytracer_store_row(uint8_t view_id, uint8_t tile_row) {
+    store_tiles(view_id, tile_row, tile_row_buffer);
+}
 
-static uint8_t dither(uint8_t brightness, uint8_t dark_color, uint8_t bright_color, 
-                      uint8_t px, uint8_t py) {
-    uint8_t threshold = bayer2x2[py & 1][px & 1];
-    return (brightness > threshold) ? bright_color : dark_color;
+void raytracer_store_scene(uint8_t view_id) {
+    (void)view_id;
 }
 
+#ifdef LINK_CABLE
+
 /*============================================================================
- * INITIALIZATION: BUILD LUTs AND PRECOMPUTED ARRAYS
+ * OPTIMIZATION 18: LINK-CABLE PARTNER
+ * The master keeps LINK_JOBS tile rows of its background view dealt to a
+ * second unit (link.c) and traces the others itself; rows are stored in
+ * order. The partner's come back packed as store codes (repeats within
+ * the row only). An own row done before a row above it stays in its tile
+ * row buffer. While one is held, or the partner's row waits for one
+ * above, or no row is left, the master takes the oldest row the partner
+ * has back instead, and whichever copy is done first is stored; a lost
+ * job's row goes back to the free rows. So the master never waits for
+ * the link, and without a partner renders alone.
  *============================================================================*/
 
-static void init_sphere_luts(void) {
-    /* oc_dot_d depends on sphere_cz (view-dependent) */
-    int16_t oc_z_fp = sphere_cz << FX8_SHIFT;
-    int16_t dz_fp = FX8_ONE;
-    oc_dot_d_constant = (int16_t)(((int32_t)oc_z_fp * dz_fp) >> FX8_SHIFT);
+/* Partner side: rows are traced, then packed once the last reply is out */
+void raytracer_trace_row(uint8_t view_id, uint8_t tile_row) {
+    if (current_view != view_id || !scene_classified[view_id]) raytracer_set_view(view_id);
+    raytracer_render_row(tile_row);
+}
+
+uint16_t raytracer_pack_row(uint8_t view_id, uint8_t tile_row, uint8_t *out) {
+    const uint8_t *map = &scene_map[view_id][tile_row * RENDER_TILES_X];
+    uint8_t last[16];
+    uint16_t n = 0;
     
-    /* Build quantized LUTs for sphere intersection divisions */
-    for (uint8_t i = 0; i < LUT_SIZE; i++) {
-        /* d_dot_d value for this LUT entry (center of quantized range) */
-        int32_t d_dot_d = LUT_MIN_VAL + ((int32_t)i << LUT_SHIFT) + (1 << (LUT_SHIFT - 1));
-        
-        /* t_hit = (oc_dot_d << FX8_SHIFT) / d_dot_d */
-        lut_t_hit[i] = (int16_t)(((int32_t)oc_dot_d_constant << FX8_SHIFT) / d_dot_d);
+    memset(last, 0xFF, 16);
+    for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
+        if (!is_mixed_tile(map[tx])) continue;
         
-        /* proj_sq = (oc_dot_d * oc_dot_d) / d_dot_d (scaled down to fit int16) */
-        lut_proj_sq[i] = (int16_t)(((int32_t)oc_dot_d_constant * oc_dot_d_constant) / d_dot_d);
+        const uint8_t *tile = &tile_row_buffer[tx * 16];
+        if (memcmp(tile, last, 16) == 0) {
+            out[n] = out[n + 1] = 0;
+            n += 2;
+        } else {
+            n += encode_tile(tile, &out[n]);
+            memcpy(last, tile, 16);
+        }
     }
+    return n;
 }
 
-static void init_shadow_lut(void) {
-    /* Shadow parameters (matching trace_ray calculations) */
-    int16_t shadow_radius_sq = (int16_t)(SPHERE_R_SQ << FX8_SHIFT);      /* 1024 */
-    int16_t umbra_radius_sq = shadow_radius_sq >> 2;                     /* 256 */
-    int16_t penumbra_range = shadow_radius_sq - umbra_radius_sq;         /* 768 */
+static void store_packed_row(uint8_t view_id, uint8_t tile_row, const uint8_t *code, uint16_t len) {
+    const uint8_t *map = &scene_map[view_id][tile_row * RENDER_TILES_X];
+    const uint8_t *end = code + len;
+    uint8_t tile[16];
     
-    /* Build LUT: map shadow_dist_sq to brightness (0-255) */
-    for (uint8_t i = 0; i < SHADOW_LUT_SIZE; i++) {
-        /* shadow_dist_sq value for this LUT entry */
-        int16_t dist_sq = (int16_t)((int32_t)i << SHADOW_LUT_SHIFT);
-        
-        if (dist_sq >= shadow_radius_sq) {
-            /* Outside shadow */
-            shadow_brightness_lut[i] = 255;
-        } else if (dist_sq <= umbra_radius_sq) {
-            /* Full shadow (umbra) */
-            shadow_brightness_lut[i] = 0;
+    if (tile_row == 0) begin_stored_view(view_id);
+    if (!scene_stored[view_id]) return;
+    
+    memset(tile, 0xFF, 16);
+    for (uint8_t tx = 0; tx < RENDER_TILES_X && code < end; tx++) {
+        if (!is_mixed_tile(map[tx])) continue;
+        code = decode_tile(code, tile);
+        if (!store_tile(view_id, tile)) return;
+    }
+}
+
+/* First row nobody has: not stored, traced or held here, nor dealt */
+static uint8_t free_row(void) {
+    for (uint8_t ty = background_stored; ty < RENDER_TILES_Y; ty++) {
+        if (ty != background_own && ty != background_held && !background_dealt[ty]) return ty;
+    }
+    return NO_ROW;
+}
+
+/* Store every row that is next in order: the partner's result, a held
+ * row. Results of another view or of a row stored already are late
+ * copies. Returns 1 while the partner's row waits for one above it. */
+static uint8_t collect_rows(void) {
+    uint8_t view_id, tile_row;
+    uint16_t len;
+    const uint8_t *code = link_result(&view_id, &tile_row, &len);
+    
+    if (code && (view_id != background_view || tile_row < background_stored)) {
+        link_release();
+        code = 0;
+    }
+    
+    while (1) {
+        if (code && tile_row == background_stored) {
+            store_packed_row(view_id, tile_row, code, len);
+            link_release();
+            code = 0;
+        } else if (background_held == background_stored) {
+            store_tiles(background_view, background_held, background_held_tiles);
+            background_held = NO_ROW;
         } else {
-            /* Penumbra (soft edge) - linear interpolation */
-            int16_t dist_in_penumbra = dist_sq - umbra_radius_sq;
-            uint8_t brightness = (uint8_t)(((int32_t)dist_in_penumbra * 256) / penumbra_range);
-            shadow_brightness_lut[i] = brightness;
+            break;
         }
+        background_stored++;
+    }
+    
+    /* Stored from the partner's copy first */
+    if (background_held < background_stored) background_held = NO_ROW;
+    
+    /* Lost jobs */
+    for (uint8_t ty = background_stored; ty < RENDER_TILES_Y; ty++) {
+        if (background_dealt[ty] && !link_dealt(background_view, ty)) background_dealt[ty] = 0;
     }
+    return code != 0;
 }
 
-static void init_dx_dy_arrays(void) {
-    int16_t half_w = RENDER_WIDTH / 2;
-    int16_t half_h = RENDER_HEIGHT / 2;
+static void take_row(uint8_t waiting) {
+    uint8_t ty = free_row();
     
-    /* Precompute dx_fp and dx_sq for each x coordinate */
-    for (uint8_t x = 0; x < RENDER_WIDTH; x++) {
-        int16_t dx = ((int16_t)x - half_w) * 5;
-        dx_fp_array[x] = dx;
-        dx_sq_array[x] = (int32_t)dx * dx;
+    /* The oldest row not stored is the partner's: take it back when the
+     * store cannot go on without it */
+    if (background_stored < RENDER_TILES_Y && background_dealt[background_stored] &&
+        (waiting || background_held != NO_ROW || ty == NO_ROW)) {
+        ty = background_stored;
     }
+    if (ty == NO_ROW) return;
+    background_own = ty;
+    background_py = ty << 3;
     
-    /* Precompute dy_fp and dy_sq for each y coordinate */
-    for (uint8_t y = 0; y < RENDER_HEIGHT; y++) {
-        int16_t dy = (half_h - (int16_t)y) * 5;
-        dy_fp_array[y] = dy;
-        dy_sq_array[y] = (int32_t)dy * dy;
+#ifndef PROGRESSIVE
+    /* Rows taken back one after the other while one is held all go into
+     * the other buffer (select_tile_row switches at py & 7 == 0) */
+    if (background_held != NO_ROW) tile_row_index = (background_held_tiles == tile_row_buffers[0]) ? 0 : 1;
+#endif
+}
+
+static void finish_row(void) {
+    if (background_own == background_stored) {
+        store_tiles(background_view, background_own, tile_row_buffer);
+        background_stored++;
+    } else {
+        background_held = background_own;
+        background_held_tiles = tile_row_buffer;
     }
-    
-    /* dz is constant */
-    int16_t dz_fp = FX8_ONE;
-    dz_sq_constant = (int32_t)dz_fp * dz_fp;
+    background_own = NO_ROW;
 }
 
-static void init_ground_scanlines(void) {
-    int16_t dz_fp = FX8_ONE;
+/* One deal per step, up to LINK_JOBS */
+static void deal_row(void) {
+    if (!link_free()) return;
     
-    /* Precompute ground intersection for each scanline */
-    for (uint8_t py = 0; py < RENDER_HEIGHT; py++) {
-        int16_t dy_fp = dy_fp_array[py];
-        scanline_dy_fp[py] = dy_fp;
-        
-        if (dy_fp < -16) {
-            /* t_ground = (-CAM_Y << (FX8_SHIFT + FX8_SHIFT)) / dy_fp */
-            int16_t t_ground = (int16_t)(((int32_t)(-CAM_Y) << (FX8_SHIFT + FX8_SHIFT)) / dy_fp);
-            
-            if (t_ground > 16 && t_ground < 2000) {
-                scanline_hit_ground[py] = 1;
-                scanline_t_ground[py] = t_ground;
-                /* OPTIMIZATION 6: Precompute ground_z for shadow calculation */
-                scanline_ground_z[py] = (int16_t)(((int32_t)dz_fp * t_ground) >> FX8_SHIFT);
-            } else {
-                scanline_hit_ground[py] = 0;
-                scanline_t_ground[py] = 0;
-                scanline_ground_z[py] = 0;
-            }
-        } else {
-            scanline_hit_ground[py] = 0;
-            scanline_t_ground[py] = 0;
-            scanline_ground_z[py] = 0;
-        }
+    uint8_t ty = free_row();
+    if (ty != NO_ROW) {
+        background_dealt[ty] = 1;
+        link_send_job(background_view, ty);
     }
 }
 
-static void init_shadow_scanlines(void) {
-    /* OPTIMIZATION 6: Precompute shadow_dz_sq for each scanline */
-    for (uint8_t py = 0; py < RENDER_HEIGHT; py++) {
-        if (scanline_hit_ground[py]) {
-            int32_t shadow_dz = (int32_t)scanline_ground_z[py] - shadow_center_z_const;
-            scanline_shadow_dz_sq[py] = (shadow_dz * shadow_dz) >> FX8_SHIFT;
+uint8_t raytracer_background_step(void) {
+    if (background_view == NO_VIEW) return 0;
+    if (background_prepare()) {
+        /* The partner selects and classifies the view meanwhile */
+        deal_row();
+        return 1;
+    }
+    
+    uint8_t waiting = collect_rows();
+    
+    /* The partner's copy of a row taken back came first */
+    if (background_own != NO_ROW && background_own < background_stored) background_own = NO_ROW;
+    if (background_own == NO_ROW) take_row(waiting);
+    deal_row();
+    
+    if (background_own != NO_ROW) {
+        raytracer_render_scanline(background_py);
+        if ((background_py & 7) == 7) {
+            finish_row();
         } else {
-            scanline_shadow_dz_sq[py] = 0;
+            background_py++;
         }
     }
+    collect_rows();
+    
+    if (background_stored == RENDER_TILES_Y) background_view = NO_VIEW;
+    return background_view != NO_VIEW;
 }
 
+#endif
+
 /*============================================================================
- * CAMERA SETUP
+ * SCENE LOADING
+ * A stored scene is a tile map plus its mixed tiles in map order. With
+ * PRERENDERED both live in ROM (src/scenes.c, rendered at build time,
+ * uncompressed); otherwise they are the WRAM map and compressed store
+ * written by raytracer_store_row.
+ * 
+ * The two most recent 96x96 views stay in VRAM, one per tile bank. Showing
+ * one of them only rewrites the render area's map and attributes; any
+ * other view is unpacked into the bank not on screen first. A full screen
+ * view has no bank to spare: it is unpacked over the one on screen, a
+ * VRAM bank's part at a time.
  *============================================================================*/
 
-void raytracer_set_view(uint8_t view_id) {
-    if (view_id == VIEW_FRONT) {
-        /* Close view: sphere at normal distance */
-        sphere_cz = SPHERE_CZ;      /* 6 units away */
-        light_dir_x = -1;
-        light_dir_z = 1;
-    } else {
-        /* Far view: sphere slightly farther (appears smaller) */
-        sphere_cz = 8;              /* 8 units away */
-        light_dir_x = -1;           /* Same light direction */
-        light_dir_z = 1;
+/* Point the render area at map, with tile data from VRAM bank vram_bank
+ * (rows past RENDER_BANK_ROWS: bank 1) */
+static void load_map_from(const uint8_t *map, uint8_t vram_bank) {
+    uint8_t map_offset_x = RENDER_OFFSET_X / 8;
+    uint8_t map_offset_y = RENDER_OFFSET_Y / 8;
+    uint8_t attr_row[RENDER_TILES_X];
+    
+    for (uint8_t ty = 0; ty < RENDER_TILES_Y; ty++) {
+        /* Palette 0, as set up by setup_palette_attributes */
+        memset(attr_row, (vram_bank | RENDER_ROW_BANK(ty)) ? BKGF_BANK1 : 0, RENDER_TILES_X);
+        
+        VBK_REG = VBK_TILES;
+        set_bkg_tiles(map_offset_x, map_offset_y + ty, RENDER_TILES_X, 1,
+                      &map[ty * RENDER_TILES_X]);
+        VBK_REG = VBK_ATTRIBUTES;
+        set_bkg_tiles(map_offset_x, map_offset_y + ty, RENDER_TILES_X, 1, attr_row);
+    }
+    VBK_REG = VBK_TILES;
+    
+    vram_shown_bank = vram_bank;
+}
+
+/* Rendering draws into VRAM bank 0 (see upload_queue.c) */
+static void begin_rendered_view(const uint8_t *map, uint8_t view_id) {
+    vram_view[VBK_BANK_0] = view_id;
+    load_map_from(map, VBK_BANK_0);
+}
+
+/* Already in VRAM: flip the render area to its bank */
+static uint8_t show_resident_view(const uint8_t *map, uint8_t view_id) {
+    for (uint8_t b = 0; b < VRAM_VIEWS; b++) {
+        if (vram_view[b] == view_id) {
+            wait_vbl_done();
+            load_map_from(map, b);
+            return 1;
+        }
     }
+    return 0;
+}
+
+/* Shared sky/ground tiles, present in both VRAM banks */
+static const uint8_t uniform_tiles[2][16] = {
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,     /* Sky (color 3) */
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF,     /* Lit ground (color 2) */
+      0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF }
+};
+
+static uint8_t staged_part;   /* RENDER_ROW_BANK of the tiles in the staging bank */
+
+/* Send the staged tiles to VRAM: all of a 96x96 view in one HBlank DMA
+ * pass into the bank not on screen (slots of uniform tiles carry stale
+ * data the map never shows), a full screen's part into its own bank */
+static void upload_staged_tiles(void) {
+    uint8_t vram_bank = (VRAM_VIEWS == 2) ? vram_shown_bank ^ 1 : staged_part;
+    uint8_t nb_tiles = staged_part ? MAX_RENDER_TILES - RENDER_BANK_TILES : RENDER_BANK_TILES;
+    uint8_t saved_bank = SVBK_REG;
     
-    /* Rebuild sphere LUTs for new distance (fast - only 64 entries) */
-    init_sphere_luts();
+    SVBK_REG = SCENE_STAGING_BANK;
+    vram_hdma_tiles(vram_bank, RENDER_TILE_BASE, nb_tiles, WRAMX_BASE);
+    SVBK_REG = saved_bank;
+}
+
+static void begin_staged_scene(void) {
+    /* Queued row uploads would overwrite the new tiles */
+    upload_queue_flush();
+    staged_part = 0;
     
-    /* OPTIMIZATION 5: Precompute shadow constants (removes per-pixel division!) */
-    int32_t t_shadow = ((int32_t)SPHERE_CY << 16) / LIGHT_Y;
+    /* A full screen view is unpacked over the one on screen */
+    if (VRAM_VIEWS == 1) vram_view[VBK_BANK_0] = NO_VIEW;
+}
+
+/* Copy render tile i of the scene being loaded into the staging bank; the
+ * first tile of VRAM bank 1's rows sends bank 0's part up first */
+static void stage_tile(uint16_t i, const uint8_t *tile) {
+    uint8_t saved_bank = SVBK_REG;
     
-    /* shadow_center = sphere_pos + (-light_dir * t_shadow) */
-    shadow_center_x_const = (int16_t)((SPHERE_CX << FX8_SHIFT) + 
-                            (((-light_dir_x * LIGHT_X) * t_shadow) >> FX8_SHIFT));
-    shadow_center_z_const = (int16_t)((sphere_cz << FX8_SHIFT) + 
-                            (((-light_dir_z * LIGHT_Z) * t_shadow) >> FX8_SHIFT));
+    if (i >= RENDER_BANK_TILES) {
+        if (!staged_part) {
+            upload_staged_tiles();
+            staged_part = 1;
+        }
+        i -= RENDER_BANK_TILES;
+    }
     
-    /* OPTIMIZATION 6: Rebuild per-scanline shadow terms for new shadow center */
-    init_shadow_scanlines();
+    SVBK_REG = SCENE_STAGING_BANK;
+    memcpy(WRAMX_BASE + i * 16, tile, 16);
+    SVBK_REG = saved_bank;
 }
 
-/*============================================================================
- * RAY TRACING (OPTIMIZED)
- *============================================================================*/
+/* Upload the rest and point the render area at the new tiles in the
+ * following VBlank */
+static void upload_staged_scene(const uint8_t *map, uint8_t view_id) {
+    uint8_t vram_bank = (VRAM_VIEWS == 2) ? vram_shown_bank ^ 1 : VBK_BANK_0;
+    
+    upload_staged_tiles();
+    
+    vram_view[vram_bank] = view_id;
+    wait_vbl_done();
+    load_map_from(map, vram_bank);
+}
+
+#ifdef PRERENDERED
+
+void raytracer_load_map(uint8_t view_id) {
+    SWITCH_ROM(BANK(prerendered_scenes));
+    begin_rendered_view(prerendered_map[view_id], view_id);
+}
 
-static uint8_t trace_ray(uint8_t px, uint8_t py) {
-    /* OPTIMIZATION 3: Use precomputed dx/dy arrays */
-    int16_t dx_fp = dx_fp_array[px];
-    int16_t dy_fp = dy_fp_array[py];
-    int16_t dz_fp = FX8_ONE;
+void raytracer_load_scene(uint8_t view_id) {
+    const uint8_t *map = prerendered_map[view_id];
+    const uint8_t *tiles;
+    
+    SWITCH_ROM(BANK(prerendered_scenes));
+    if (show_resident_view(map, view_id)) return;
     
-    /* OPTIMIZATION 3: d_dot_d from precomputed squares */
-    int16_t d_dot_d = (int16_t)((dx_sq_array[px] + dy_sq_array[py] + dz_sq_constant) >> FX8_SHIFT);
+    tiles = &prerendered_tiles[prerendered_tile_base[view_id] * 16];
+    
+    /* Mixed tiles are stored uncompressed in map order */
+    begin_staged_scene();
+    for (uint16_t i = 0; i < MAX_RENDER_TILES; i++) {
+        if (!is_mixed_tile(map[i])) continue;
+        stage_tile(i, tiles);
+        tiles += 16;
+    }
+    upload_staged_scene(map, view_id);
+}
+
+#else
+
+void raytracer_load_map(uint8_t view_id) {
+    begin_rendered_view(scene_map[view_id], view_id);
+}
+
+/* Unpack a stored view into the VRAM bank not on screen and show it;
+ * returns 0 if it is not stored (out of WRAM banks) */
+static uint8_t unpack_stored_scene(uint8_t view_id) {
+    const uint8_t *map = scene_map[view_id];
+    uint8_t code[TILE_CODE_MAX];  /* On the stack, so in bank 0 */
+    uint8_t tile[16];
     
-    /* Clamp d_dot_d to LUT range and compute quantized index */
-    if (d_dot_d < LUT_MIN_VAL) d_dot_d = LUT_MIN_VAL;
-    if (d_dot_d > LUT_MAX_VAL) d_dot_d = LUT_MAX_VAL;
+    if (!scene_stored[view_id]) return 0;
     
-    /* OPTIMIZATION 1: Use quantized LUTs for sphere intersection (no division!) */
-    uint8_t lut_index = (uint8_t)((d_dot_d - LUT_MIN_VAL) >> LUT_SHIFT);
-    if (lut_index >= LUT_SIZE) lut_index = LUT_SIZE - 1;
+    uint16_t pos = scene_store_start[view_id];
+    uint16_t end = scene_store_end[view_id];
     
-    int16_t t_hit = lut_t_hit[lut_index];
-    int32_t proj_sq = (int32_t)lut_proj_sq[lut_index];
+    /* Each tile's code is bounced through bank 0, decoded and staged */
+    begin_staged_scene();
+    memset(tile, 0xFF, 16);
+    for (uint16_t i = 0; i < MAX_RENDER_TILES && pos < end; i++) {
+        if (!is_mixed_tile(map[i])) continue;
+        uint16_t n = end - pos;
+        if (n > TILE_CODE_MAX) n = TILE_CODE_MAX;
+        store_copy(pos, code, n, 0);
+        pos += (uint16_t)(decode_tile(code, tile) - code);
+        stage_tile(i, tile);
+    }
     
-    /* Sphere intersection test */
-    int32_t oc_sq = (int32_t)sphere_cz * sphere_cz;
-    int32_t dist_sq_fp = (oc_sq << FX8_SHIFT) - proj_sq;
-    int32_t radius_sq_fp = SPHERE_R_SQ << FX8_SHIFT;
+    upload_staged_scene(map, view_id);
+    return 1;
+}
+
+void raytracer_load_scene(uint8_t view_id) {
+    const uint8_t *map = scene_map[view_id];
     
-    uint8_t hit_sphere = 0;
+    if (show_resident_view(map, view_id)) return;
     
-    if (dist_sq_fp < radius_sq_fp && oc_dot_d_constant > 0) {
-        hit_sphere = 1;
-        /* t_hit already loaded from LUT */
+    /* Not stored: leave the render area as it is */
+    if (!unpack_stored_scene(view_id)) {
+        load_map_from(map, vram_shown_bank);
     }
+}
+
+#endif
+
+/*============================================================================
+ * OPTIMIZATION 15: SRAM SCENE CACHE (SRAM_CACHE)
+ * The cartridge's battery-backed RAM keeps each view's tile map and its
+ * compressed tiles, copied out of the scene store when the view is first
+ * rendered. The header holds the scene_hash of the build that wrote it, so
+ * a ROM with other scene constants or tables starts over. At boot the
+ * cached views are copied back into the store; from there they load like
+ * any rendered view, and SRAM stays disabled the rest of the time. A view
+ * only counts once its bit is set, which is written last.
+ *============================================================================*/
+
+#ifdef SRAM_CACHE
+
+#ifndef SRAM_BASE
+#define SRAM_BASE  ((uint8_t *)0xA000)
+#endif
+
+#define SCENE_CACHE_MAGIC    0x5254u   /* "RT" */
+/* Bump when the tile code changes; bit 7: 4x4 dither (luts.c is the same
+ * for both patterns, so scene_hash does not tell them apart) */
+#ifdef DITHER_4X4
+#define SCENE_CACHE_VERSION  0x81
+#else
+#define SCENE_CACHE_VERSION  0x01
+#endif
+#define SCENE_CACHE_SIZE     0x2000    /* One 8KB SRAM bank */
+
+typedef struct {
+    uint16_t magic;
+    uint8_t version;
+    uint32_t hash;                              /* scene_hash of the writer */
+    uint8_t views;                              /* Bit v: view v is complete */
+    uint16_t used;                              /* Code bytes after the header */
+    uint16_t start[NUM_VIEWS];                  /* Each view's code, from SRAM_BASE */
+    uint16_t end[NUM_VIEWS];
+    uint8_t map[NUM_VIEWS][MAX_RENDER_TILES];
+#ifdef MOVING_LIGHT
+    tile_row_mask_t detail[NUM_VIEWS][RENDER_TILES_Y];
+#endif
+} scene_cache_t;
+
+#define scene_cache  ((scene_cache_t *)SRAM_BASE)
+
+uint8_t raytracer_cache_restore(void) {
+    uint8_t views = 0;
     
-    /* OPTIMIZATION 2: Ground intersection from scanline precompute (no division!) */
-    uint8_t hit_ground = scanline_hit_ground[py];
-    int16_t t_ground = scanline_t_ground[py];
-    int16_t ground_x = 0, ground_z = 0;
+    ENABLE_RAM;
+    SWITCH_RAM(0);
     
-    if (hit_ground) {
-        ground_x = (int16_t)(((int32_t)dx_fp * t_ground) >> FX8_SHIFT);
-        ground_z = scanline_ground_z[py];
+    if (scene_cache->magic != SCENE_CACHE_MAGIC || scene_cache->version != SCENE_CACHE_VERSION ||
+        scene_cache->hash != scene_hash) {
+        scene_cache->views = 0;
+        scene_cache->used = sizeof(scene_cache_t);
+        scene_cache->magic = SCENE_CACHE_MAGIC;
+        scene_cache->version = SCENE_CACHE_VERSION;
+        scene_cache->hash = scene_hash;
+        DISABLE_RAM;
+        return 0;
     }
     
-    /*=== SPHERE SHADING ===*/
-    if (hit_sphere && (!hit_ground || t_hit < t_ground)) {
-        int16_t hx = (int16_t)(((int32_t)dx_fp * t_hit) >> FX8_SHIFT);
-        int16_t hy = (CAM_Y << FX8_SHIFT) + (int16_t)(((int32_t)dy_fp * t_hit) >> FX8_SHIFT);
-        int16_t hz = (int16_t)(((int32_t)dz_fp * t_hit) >> FX8_SHIFT);
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        if (!(scene_cache->views & (1 << v))) continue;
         
-        /* Normal = hit point - sphere center */
-        int16_t nx = hx;
-        int16_t ny = hy - (SPHERE_CY << FX8_SHIFT);
-        int16_t nz = hz - (sphere_cz << FX8_SHIFT);
-        nx >>= 1;
-        ny >>= 1;
-        nz >>= 1;
+        uint16_t n = scene_cache->end[v] - scene_cache->start[v];
+        if (n > SCENE_STORE_SIZE - scene_store_used) break;
+        begin_stored_view(v);
         
-        /* Light direction (adjusted for view) */
-        int16_t lx = light_dir_x * LIGHT_X;
-        int16_t ly = LIGHT_Y;
-        int16_t lz = light_dir_z * LIGHT_Z;
+        store_copy(scene_store_used, SRAM_BASE + scene_cache->start[v], n, 1);
+        scene_store_used += n;
+        scene_store_end[v] = scene_store_used;
         
-        /* Lambert shading */
-        int32_t dot = ((int32_t)nx * lx + (int32_t)ny * ly + (int32_t)nz * lz) >> FX8_SHIFT;
+        memcpy(scene_map[v], scene_cache->map[v], MAX_RENDER_TILES);
+#ifdef MOVING_LIGHT
+        memcpy(scene_detail[v], scene_cache->detail[v], sizeof(scene_detail[v]));
+#endif
+        scene_classified[v] = 1;
         
-        int16_t brightness = 50;  /* Ambient */
-        if (dot > 0) {
-            brightness += (dot * 205) >> 8;
+        /* VRAM may hold an older picture of it */
+        for (uint8_t b = 0; b < 2; b++) {
+            if (vram_view[b] == v) vram_view[b] = NO_VIEW;
         }
-        if (brightness > 255) brightness = 255;
-        
-        return dither((uint8_t)brightness, COLOR_SHADOW, COLOR_SPHERE, px, py);
+        views |= 1 << v;
     }
     
-    /*=== GROUND SHADING WITH DIRECTIONAL SHADOW (FULLY OPTIMIZED) ===*/
-    if (hit_ground) {
-        /* OPTIMIZATION 5: Use precomputed shadow center (no division!) */
-        /* OPTIMIZATION 6: Use precomputed shadow_dz_sq from scanline */
-        int32_t shadow_dx = (int32_t)ground_x - shadow_center_x_const;
-        int32_t shadow_dx_sq = (shadow_dx * shadow_dx) >> FX8_SHIFT;
-        int32_t shadow_dist_sq = shadow_dx_sq + scanline_shadow_dz_sq[py];
-        
-        /* OPTIMIZATION 4: Use shadow LUT (no division!) */
-        /* Clamp to valid range BEFORE casting to prevent overflow */
-        int16_t max_lut_value = (SHADOW_LUT_SIZE - 1) << SHADOW_LUT_SHIFT;
-        uint8_t lut_idx;
-        
-        if (shadow_dist_sq >= max_lut_value) {
-            lut_idx = SHADOW_LUT_SIZE - 1;  /* Far from shadow = full brightness */
-        } else if (shadow_dist_sq <= 0) {
-            lut_idx = 0;
-        } else {
-            lut_idx = (uint8_t)(shadow_dist_sq >> SHADOW_LUT_SHIFT);
-        }
-        
-        uint8_t brightness = shadow_brightness_lut[lut_idx];
-        
-        return dither(brightness, COLOR_SHADOW, COLOR_GROUND, px, py);
+    DISABLE_RAM;
+    return views;
+}
+
+void raytracer_cache_view(uint8_t view_id) {
+    uint16_t n = scene_store_end[view_id] - scene_store_start[view_id];
+    
+    if (!scene_stored[view_id]) return;
+    
+    ENABLE_RAM;
+    SWITCH_RAM(0);
+    
+    /* Already in, or full: the cache is only appended to */
+    uint16_t start = scene_cache->used;
+    if ((scene_cache->views & (1 << view_id)) || n > SCENE_CACHE_SIZE - start) {
+        DISABLE_RAM;
+        return;
     }
     
-    return COLOR_SKY;
+    store_copy(scene_store_start[view_id], SRAM_BASE + start, n, 0);
+    
+    memcpy(scene_cache->map[view_id], scene_map[view_id], MAX_RENDER_TILES);
+#ifdef MOVING_LIGHT
+    memcpy(scene_cache->detail[view_id], scene_detail[view_id], sizeof(scene_detail[view_id]));
+#endif
+    scene_cache->start[view_id] = start;
+    scene_cache->end[view_id] = start + n;
+    scene_cache->used = start + n;
+    scene_cache->views |= 1 << view_id;
+    
+    DISABLE_RAM;
 }
 
+#endif
+
 /*============================================================================
- * TILE GENERATION & STORAGE
+ * OPTIMIZATION 12: DIRTY-TILE RELIGHTING (MOVING_LIGHT)
+ * Sliding the light along x changes the sphere's shading and moves the
+ * shadow, nothing else. So only tiles that a sphere or penumbra span
+ * touched before or touches now (classify_tiles keeps them per view) can
+ * change: their tile rows are re-rendered and just that range of tiles is
+ * uploaded. Map entries that switch between a shared uniform tile and the
+ * view's own tile are queued after the row's tiles. Other rows with mixed
+ * tiles (the horizon) are rendered for the stored scene but not uploaded.
  *============================================================================*/
 
-/* Small buffer for one scanline (12 tiles × 2 bytes = 24 bytes) */
-static uint8_t scanline_buffer[RENDER_TILES_X * 2];
+#ifdef MOVING_LIGHT
 
-void raytracer_render_row(uint8_t tile_row) {
-    uint8_t base_py = tile_row * 8;
+int16_t raytracer_light_x(uint8_t view_id) {
+    return view_light_x[view_id];
+}
+
+int16_t raytracer_light_z(uint8_t view_id) {
+    return view_light_z[view_id];
+}
+
+static tile_row_mask_t mixed_tiles(const uint8_t *map_row) {
+    tile_row_mask_t mask = 0;
     
     for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
-        uint8_t *tile_data = &tile_row_buffer[tx * 16];
-        uint8_t base_px = tx * 8;
+        if (is_mixed_tile(map_row[tx])) mask |= (tile_row_mask_t)1 << tx;
+    }
+    return mask;
+}
+
+/* Queue the cells of tile row ty that differ from old_row (runs of one
+ * uniform tile as one job) */
+static void queue_map_changes(uint8_t ty, const uint8_t *old_row, const uint8_t *map_row) {
+    uint8_t tx = 0;
+    
+    while (tx < RENDER_TILES_X) {
+        uint8_t start = tx, tile = map_row[tx];
         
-        for (uint8_t row = 0; row < 8; row++) {
-            uint8_t low_bits = 0;
-            uint8_t high_bits = 0;
-            uint8_t py = base_py + row;
-            
-            for (uint8_t col = 0; col < 8; col++) {
-                uint8_t color = trace_ray(base_px + col, py);
-                uint8_t bit_pos = 7 - col;
-                
-                if (color & 0x01) low_bits  |= (1 << bit_pos);
-                if (color & 0x02) high_bits |= (1 << bit_pos);
-            }
-            
-            tile_data[row * 2]     = low_bits;
-            tile_data[row * 2 + 1] = high_bits;
+        while (tx < RENDER_TILES_X && map_row[tx] == tile && old_row[tx] != tile) tx++;
+        if (tx == start) {
+            tx++;
+        } else {
+            upload_queue_map_fill(RENDER_OFFSET_X / 8 + start, RENDER_OFFSET_Y / 8 + ty, tx - start, tile);
         }
     }
 }
 
-/*============================================================================
- * SCANLINE-BY-SCANLINE RENDERING (smoother visual feedback)
- *============================================================================*/
-
-void raytracer_render_scanline(uint8_t py) {
-    /* Clear tile buffer at start of each tile row */
-    if ((py & 7) == 0) {
-        memset(tile_row_buffer, 0, RENDER_TILES_X * 16);
+void raytracer_move_light(uint8_t view_id, int16_t lx, int16_t lz) {
+    uint8_t old_row[RENDER_TILES_X];   /* A row at a time: the whole map would not fit the stack */
+    uint8_t reuse = 1;  /* Clean tiles are current in VRAM bank 0 */
+    
+    /* A view half traced in the background would be split in the store */
+    raytracer_background_finish();
+    
+    /* The last move's uploads still read the row buffers */
+    upload_queue_flush();
+    
+    /* Relit tiles go to the render rows' own VRAM bank, 0 for a 96x96
+     * view: unpack a view shown from bank 1 there first, the bank 1 copy
+     * goes stale */
+    if (vram_shown_bank != VBK_BANK_0) {
+        reuse = unpack_stored_scene(view_id);
+        vram_view[VBK_BANK_1] = NO_VIEW;
     }
     
-    /* Render one horizontal line (96 pixels) into scanline_buffer */
-    for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
-        uint8_t low_bits = 0;
-        uint8_t high_bits = 0;
-        uint8_t base_px = tx * 8;
+    /* raytracer_set_view selects the new light (the view is classified:
+     * its rows are reclassified one at a time below) */
+    view_light_x[view_id] = lx;
+    view_light_z[view_id] = lz;
+    raytracer_set_view(view_id);
+    
+    for (uint8_t ty = 0; ty < RENDER_TILES_Y; ty++) {
+        const uint8_t *map_row = &scene_map[view_id][ty * RENDER_TILES_X];
+        tile_row_mask_t old_detail = scene_detail[view_id][ty];
         
-        for (uint8_t col = 0; col < 8; col++) {
-            uint8_t color = trace_ray(base_px + col, py);
-            uint8_t bit_pos = 7 - col;
-            
-            if (color & 0x01) low_bits  |= (1 << bit_pos);
-            if (color & 0x02) high_bits |= (1 << bit_pos);
+        memcpy(old_row, map_row, RENDER_TILES_X);
+        classify_row(view_id, ty);
+        
+        tile_row_mask_t mixed = mixed_tiles(map_row);
+        tile_row_mask_t dirty = mixed;
+        
+        if (reuse) dirty &= old_detail | scene_detail[view_id][ty];
+        
+        /* Rows without mixed tiles have nothing to store or upload */
+        if (mixed) {
+            for (uint8_t row = 0; row < 8; row++) {
+                raytracer_render_scanline(ty * 8 + row);
+            }
         }
         
-        scanline_buffer[tx * 2]     = low_bits;
-        scanline_buffer[tx * 2 + 1] = high_bits;
+        if (dirty) {
+            uint8_t first = 0, last = RENDER_TILES_X;
+            
+            while (!(dirty & ((tile_row_mask_t)1 << first))) first++;
+            while (!(dirty & ((tile_row_mask_t)1 << (last - 1)))) last--;
+            tile_row_tickets[tile_row_index] =
+                upload_queue_tiles(RENDER_ROW_BANK(ty), RENDER_ROW_TILE(ty) + first, last - first,
+                                   &tile_row_buffer[first * 16]);
+        }
+        if (reuse) queue_map_changes(ty, old_row, map_row);
         
-        /* Also store into tile_row_buffer for scene storage */
-        uint8_t row_in_tile = py & 7;
-        tile_row_buffer[tx * 16 + row_in_tile * 2]     = low_bits;
-        tile_row_buffer[tx * 16 + row_in_tile * 2 + 1] = high_bits;
+        raytracer_store_row(view_id, ty);
     }
-}
-
-void raytracer_upload_scanline(uint8_t py) {
-    /* Upload the current tile row's accumulated data to VRAM */
-    /* Since we build tile_row_buffer scanline by scanline, upload after each */
-    uint8_t tile_row = py / 8;
-    uint8_t tile_start = RENDER_TILE_BASE + tile_row * RENDER_TILES_X;
     
-    /* Upload all tiles in this row (their partial data so far) */
-    set_bkg_data(tile_start, RENDER_TILES_X, tile_row_buffer);
+    /* Nothing to reuse in bank 0: all mixed tiles went up, show them */
+    if (!reuse) {
+        upload_queue_flush();
+        wait_vbl_done();
+        begin_rendered_view(scene_map[view_id], view_id);
+    }
 }
 
-void raytracer_upload_row(uint8_t tile_row) {
-    uint8_t tile_start = RENDER_TILE_BASE + tile_row * RENDER_TILES_X;
-    set_bkg_data(tile_start, RENDER_TILES_X, tile_row_buffer);
-}
+#endif
 
-void raytracer_store_row(uint8_t view_id, uint8_t tile_row) {
-    memcpy(&scene_buffer[view_id][tile_row * RENDER_TILES_X * 16], 
-           tile_row_buffer, RENDER_TILES_X * 16);
-}
+/*============================================================================
+ * LIGHT SWEEP (LIGHT_SWEEP)
+ * The view's baked light turns about the vertical axis, a full circle in
+ * 256 angle steps; its height stays. The camera, the rays and the sphere
+ * and ground LUTs stay as they are, so a step is a MOVING_LIGHT relight
+ * and works for any scene.
+ *============================================================================*/
 
-void raytracer_store_scene(uint8_t view_id) {
-    (void)view_id;
+#ifdef LIGHT_SWEEP
+
+static uint8_t view_angle[NUM_VIEWS];
+
+uint8_t raytracer_light_angle(uint8_t view_id) {
+    return view_angle[view_id];
 }
 
-void raytracer_load_scene(uint8_t view_id) {
-    set_bkg_data(RENDER_TILE_BASE, MAX_RENDER_TILES, scene_buffer[view_id]);
+void raytracer_sweep_light(uint8_t view_id, uint8_t angle) {
+    /* The baked light (x0, z0) turned by -angle: x along (cos, sin), z
+     * along (-sin, cos) */
+    SWITCH_ROM(BANK(raytracer_luts));
+    int16_t x0 = view_luts[view_id].light_dir_x * LIGHT_X;
+    int16_t z0 = view_luts[view_id].light_dir_z * LIGHT_Z;
+    fixed8_t s = fx_sin(angle);
+    fixed8_t c = fx_cos(angle);
+    
+    view_angle[view_id] = angle;
+    raytracer_move_light(view_id, FX8_MUL(x0, c) + FX8_MUL(z0, s), FX8_MUL(z0, c) - FX8_MUL(x0, s));
 }
 
+#endif
+
 /*============================================================================
  * PUBLIC API: INITIALIZATION
  *============================================================================*/
 
 void raytracer_init(void) {
-    /* Initialize sphere to front view distance */
-    sphere_cz = SPHERE_CZ;
-    light_dir_x = -1;
-    light_dir_z = 1;
+    tile_row_buffers[0] = (uint8_t *)(((uintptr_t)wram_arena.render.tile_rows + 15) & ~(uintptr_t)15);
+    for (uint8_t i = 1; i < TILE_ROW_BUFFERS; i++) {
+        tile_row_buffers[i] = tile_row_buffers[i - 1] + TILE_ROW_SIZE;
+    }
+    tile_row_buffer = tile_row_buffers[0];
     
-    /* Initialize all LUTs and precomputed arrays once at startup */
-    init_sphere_luts();
-    init_shadow_lut();
-    init_dx_dy_arrays();
-    init_ground_scanlines();
+    /* LUTs are generated at build time; just map their bank and the front view */
+    SWITCH_ROM(BANK(raytracer_luts));
+    view = &view_luts[VIEW_FRONT];
+#ifdef MOVING_LIGHT
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        view_light_x[v] = view_luts[v].light_dir_x * LIGHT_X;
+        view_light_z[v] = view_luts[v].light_dir_z * LIGHT_Z;
+    }
+#endif
 }
 
 void raytracer_init_vram(void) {
@@ -478,11 +1935,23 @@ void raytracer_init_vram(void) {
     memset(border_tile, 0xFF, 16);
     set_bkg_data(0, 1, border_tile);
     
-    /* Clear render tiles */
+    /* Shared uniform tiles (solid sky, solid lit ground), in both banks so
+     * uniform map entries work whichever bank a view is in */
+    for (uint8_t b = 0; b < 2; b++) {
+        VBK_REG = b;
+        set_bkg_data(RENDER_TILE_SKY, 1, uniform_tiles[0]);
+        set_bkg_data(RENDER_TILE_GROUND, 1, uniform_tiles[1]);
+    }
+    VBK_REG = VBK_TILES;
+    
+    /* Clear render tiles (a full screen's lower rows: in bank 1) */
     uint8_t empty_tile[16];
     memset(empty_tile, 0x00, 16);
-    for (uint8_t i = 0; i < MAX_RENDER_TILES; i++) {
-        set_bkg_data(RENDER_TILE_BASE + i, 1, empty_tile);
+    for (uint8_t ty = 0; ty < RENDER_TILES_Y; ty++) {
+        VBK_REG = RENDER_ROW_BANK(ty);
+        for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
+            set_bkg_data(RENDER_ROW_TILE(ty) + tx, 1, empty_tile);
+        }
     }
     
     /* Fill tile map with border */
@@ -497,7 +1966,7 @@ void raytracer_init_vram(void) {
     for (uint8_t ty = 0; ty < RENDER_TILES_Y; ty++) {
         uint8_t tile_row_map[RENDER_TILES_X];
         for (uint8_t tx = 0; tx < RENDER_TILES_X; tx++) {
-            tile_row_map[tx] = RENDER_TILE_BASE + ty * RENDER_TILES_X + tx;
+            tile_row_map[tx] = RENDER_ROW_TILE(ty) + tx;
         }
         set_bkg_tiles(map_offset_x, map_offset_y + ty, RENDER_TILES_X, 1, tile_row_map);
     }
@@ -6,47 +6,79 @@
 #define _RAYTRACER_H
 
 #include <stdint.h>
-
-/*============================================================================
- * FIXED-POINT MATH (8.8 format)
- *============================================================================*/
-
-typedef int16_t fixed8_t;
-
-#define FX8_SHIFT       8
-#define FX8_ONE         (1 << FX8_SHIFT)
-#define FX8_HALF        (FX8_ONE >> 1)
-
-#define INT_TO_FX8(x)   ((fixed8_t)((x) << FX8_SHIFT))
-#define FX8_TO_INT(x)   ((int8_t)((x) >> FX8_SHIFT))
-#define FX8_MUL(a, b)   ((fixed8_t)(((int32_t)(a) * (int32_t)(b)) >> FX8_SHIFT))
+#include "fxmath.h"
 
 /*============================================================================
  * SCENE CONFIGURATION
  *============================================================================*/
 
+/* FULL_SCREEN: the whole 160x144 LCD instead of a 96x96 window */
+#ifdef FULL_SCREEN
+#define RENDER_WIDTH    160
+#define RENDER_HEIGHT   144
+#else
 #define RENDER_WIDTH    96
 #define RENDER_HEIGHT   96
+#endif
 
-#define RENDER_TILES_X  (RENDER_WIDTH / 8)   /* 12 */
-#define RENDER_TILES_Y  (RENDER_HEIGHT / 8)  /* 12 */
+#define RENDER_TILES_X  (RENDER_WIDTH / 8)   /* 12 (FULL_SCREEN: 20) */
+#define RENDER_TILES_Y  (RENDER_HEIGHT / 8)  /* 12 (FULL_SCREEN: 18) */
 
 #define RENDER_OFFSET_X ((160 - RENDER_WIDTH) / 2)
 #define RENDER_OFFSET_Y ((144 - RENDER_HEIGHT) / 2)
 
 #define RENDER_TILE_BASE 1
-#define MAX_RENDER_TILES (RENDER_TILES_X * RENDER_TILES_Y)  /* 144 */
+#define MAX_RENDER_TILES (RENDER_TILES_X * RENDER_TILES_Y)  /* 144 (FULL_SCREEN: 360) */
+
+/* A map entry reaches 256 tiles of one VRAM bank. A full screen's tiles are
+ * split by tile row: rows from RENDER_BANK_ROWS on are in VRAM bank 1 (the
+ * attribute bank bit), at the same tile numbers as the rows above. Bank 0's
+ * part also fits the 4KB staging bank. A 96x96 view fits one bank, so each
+ * bank holds a whole view. */
+#ifdef FULL_SCREEN
+#define RENDER_BANK_ROWS  12
+#else
+#define RENDER_BANK_ROWS  RENDER_TILES_Y
+#endif
+#define RENDER_BANK_TILES   (RENDER_BANK_ROWS * RENDER_TILES_X)  /* 144 (FULL_SCREEN: 240) */
+#define RENDER_ROW_BANK(ty) ((uint8_t)((ty) >= RENDER_BANK_ROWS))
+#define RENDER_ROW_TILE(ty) ((uint8_t)(RENDER_TILE_BASE + \
+                             ((ty) - RENDER_ROW_BANK(ty) * RENDER_BANK_ROWS) * RENDER_TILES_X))
+
+/* Bytes per scene (16 per tile) */
+#define SCENE_SIZE      (MAX_RENDER_TILES * 16)  /* 2304 bytes (FULL_SCREEN: 5760) */
 
-/* Bytes per scene (144 tiles * 16 bytes) */
-#define SCENE_SIZE      (MAX_RENDER_TILES * 16)  /* 2304 bytes */
+/* Shared tiles for uniform render tiles (after the progress tile at 145) */
+#define RENDER_TILE_SKY     (RENDER_TILE_BASE + RENDER_BANK_TILES + 1)  /* 146 (FULL_SCREEN: 242) */
+#define RENDER_TILE_GROUND  (RENDER_TILE_BASE + RENDER_BANK_TILES + 2)  /* 147 (FULL_SCREEN: 243) */
 
 /*============================================================================
  * CAMERA VIEWS
  *============================================================================*/
 
-#define VIEW_FRONT      0   /* Down button - close view (sphere at 6 units) */
-#define VIEW_BACK       1   /* Up button - far view (sphere at 12 units) */
-#define NUM_VIEWS       2
+#define VIEW_FRONT        0   /* Down button - close view (sphere at 6 units) */
+#define VIEW_BACK         1   /* Up button - far view (sphere at 8 units) */
+#define VIEW_FRONT_RIGHT  2   /* Right + Down - close view, light from the right */
+#define VIEW_BACK_RIGHT   3   /* Right + Up - far view, light from the right */
+#define NUM_VIEWS         4
+
+/* { sphere_cz, light_dir_x, light_dir_z } for each VIEW_*, baked into ROM */
+#define VIEW_PARAMS { \
+    { SPHERE_CZ, -1, 1 },   /* VIEW_FRONT: sphere at normal distance */ \
+    { 8,         -1, 1 },   /* VIEW_BACK: sphere farther, same light */ \
+    { SPHERE_CZ,  1, 1 },   /* VIEW_FRONT_RIGHT: mirrored light */ \
+    { 8,          1, 1 }    /* VIEW_BACK_RIGHT */ \
+}
+
+/* Compressed mixed (non-uniform) tiles live in CGB WRAM banks 1-6 (4KB
+ * each), one stream that runs on from bank to bank. The shipped 96x96
+ * views need 217-371 bytes each, so at least 66 of them fit.
+ * Bank 7 holds the uncompressed scene being DMA'd to VRAM on a load (a
+ * VRAM bank's part at a time). */
+#define SCENE_WRAM_FIRST_BANK  1
+#define SCENE_WRAM_LAST_BANK   6
+#define SCENE_STAGING_BANK     7
+#define SCENE_WRAM_BANK_SIZE   0x1000
 
 /*============================================================================
  * SCENE OBJECTS
@@ -60,10 +92,68 @@ typedef int16_t fixed8_t;
 
 #define CAM_Y           2   /* Camera height */
 
+/* Spheres of each view, { x, z } in whole units from the view's sphere
+ * (SPHERE_CX, sphere_cz). All have radius SPHERE_R and rest on the ground
+ * with their centers at camera height, and must not intersect. Tile bins
+ * (raytracer.c) hold a sphere and a shadow bit per object. */
+#ifdef MULTI_SPHERE
+#define SCENE_OBJECTS   { { 0, 0 }, { -4, 2 }, { 4, 3 } }
+#define NUM_OBJECTS     3
+#else
+#define SCENE_OBJECTS   { { 0, 0 } }
+#define NUM_OBJECTS     1
+#endif
+#define MAX_OBJECTS     4
+
+#if NUM_OBJECTS > MAX_OBJECTS
+#error "SCENE_OBJECTS: at most MAX_OBJECTS spheres"
+#endif
+
 #define LIGHT_X         (-128)
 #define LIGHT_Y         (179)
 #define LIGHT_Z         (128)
 
+/* A light sweep turns the light around the view (see raytracer_sweep_light) */
+#ifdef LIGHT_SWEEP
+#define SWEEP_STEP      4   /* Angle per sweep step (64 per turn) */
+#ifndef MOVING_LIGHT
+#define MOVING_LIGHT
+#endif
+#endif
+
+#ifdef MOVING_LIGHT
+/* The light slides along x between the two baked sides (light_dir_x = +1
+ * and -1); y and z stay */
+#define LIGHT_X_MIN     LIGHT_X
+#define LIGHT_X_MAX     (-LIGHT_X)
+#define LIGHT_MOVE_STEP 16
+
+#ifdef PRERENDERED
+#error "MOVING_LIGHT re-renders views on the device; build it without PRERENDERED"
+#endif
+#endif
+
+#ifdef FULL_SCREEN
+#ifdef PROGRESSIVE
+#error "PROGRESSIVE buffers every tile row, 5760 bytes of WRAM bank 0 at full screen; build it without FULL_SCREEN"
+#endif
+#ifdef PROFILE
+#error "The PROFILE HUD and font need a screen row and tiles outside the render area; build it without FULL_SCREEN"
+#endif
+#endif
+
+#ifdef SRAM_CACHE
+#ifdef PRERENDERED
+#error "SRAM_CACHE keeps views rendered on the device; build it without PRERENDERED"
+#endif
+#endif
+
+#ifdef LINK_CABLE
+#ifdef PRERENDERED
+#error "LINK_CABLE shares the render of views on the device; build it without PRERENDERED"
+#endif
+#endif
+
 /*============================================================================
  * COLORS
  *============================================================================*/
@@ -77,10 +167,10 @@ typedef int16_t fixed8_t;
  * FUNCTION DECLARATIONS
  *============================================================================*/
 
-/* Initialize LUTs and precomputed arrays (call once at startup) */
+/* Select the ROM LUT bank and front view (call once at startup) */
 void raytracer_init(void);
 
-/* Set camera angle for rendering (0=front, 64=right, 128=back, 192=left) */
+/* Select a VIEW_* for rendering */
 void raytracer_set_view(uint8_t view_id);
 
 /* Render one tile row (8 scanlines) of the current view */
@@ -95,6 +185,49 @@ void raytracer_render_scanline(uint8_t py);
 /* Upload single scanline to VRAM */
 void raytracer_upload_scanline(uint8_t py);
 
+#ifdef PROGRESSIVE
+/* Scanline to render i-th (0-95) in a coarse-to-fine pass order */
+uint8_t raytracer_progressive_scanline(uint8_t i);
+#endif
+
+/* Background render: trace view_id a scanline per raytracer_background_step
+ * call into its stored scene, without touching VRAM. A step returns 0 once
+ * the view is stored (or no job is running); finish runs the rest at once. */
+void raytracer_background_begin(uint8_t view_id);
+uint8_t raytracer_background_step(void);
+void raytracer_background_finish(void);
+
+/* Scanlines of the job's view that are done (for the progress bar) */
+uint8_t raytracer_background_progress(void);
+
+#ifdef LINK_CABLE
+/* Partner side: render tile_row of view_id, then pack its mixed tiles
+ * into out (at most 18 bytes each); pack returns the length */
+void raytracer_trace_row(uint8_t view_id, uint8_t tile_row);
+uint16_t raytracer_pack_row(uint8_t view_id, uint8_t tile_row, uint8_t *out);
+#endif
+
+#ifdef MOVING_LIGHT
+/* Horizontal light direction (8.8, camera frame; y is LIGHT_Y) a view was
+ * last rendered with */
+int16_t raytracer_light_x(uint8_t view_id);
+int16_t raytracer_light_z(uint8_t view_id);
+
+/* Move the light of view_id, which is on screen, to (light_x, light_z):
+ * only tiles the sphere or the old or new shadow touch are re-traced and
+ * uploaded, the rest of the picture stays in VRAM. The stored scene is
+ * updated. */
+void raytracer_move_light(uint8_t view_id, int16_t light_x, int16_t light_z);
+#endif
+
+#ifdef LIGHT_SWEEP
+/* Turn the baked light of view_id, which is on screen, about the vertical
+ * axis to angle (256 per turn; at 192 it is the light the *_RIGHT views
+ * bake), relit as above. The camera does not move. */
+void raytracer_sweep_light(uint8_t view_id, uint8_t angle);
+uint8_t raytracer_light_angle(uint8_t view_id);
+#endif
+
 /* Initialize VRAM structures */
 void raytracer_init_vram(void);
 
@@ -104,11 +237,22 @@ void raytracer_store_row(uint8_t view_id, uint8_t tile_row);
 /* Store current rendered scene to buffer (not used with per-row storage) */
 void raytracer_store_scene(uint8_t view_id);
 
-/* Load pre-rendered scene from buffer to VRAM */
-void raytracer_load_scene(uint8_t view_id);
+#ifdef SRAM_CACHE
+/* Put the views found in the battery-backed cache back into the scene
+ * store and return them (bit v: view v); a cache written by a build with
+ * another scene_hash is emptied */
+uint8_t raytracer_cache_restore(void);
+
+/* Copy a view that was just rendered and stored into the cache */
+void raytracer_cache_view(uint8_t view_id);
+#endif
 
-/* Trig functions */
-fixed8_t fx_sin(uint8_t angle);
-fixed8_t fx_cos(uint8_t angle);
+/* Point the render area tile map at a view's tiles (uniform tiles shared)
+ * in VRAM bank 0, where it is about to be rendered */
+void raytracer_load_map(uint8_t view_id);
+
+/* Show a pre-rendered scene: a flip between VRAM banks if it is one of the
+ * last two shown, otherwise unpacked from its buffer into the hidden bank */
+void raytracer_load_scene(uint8_t view_id);
 
 #endif
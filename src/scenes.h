@@ -0,0 +1,22 @@
+/**
+ * scenes.h - Scenes rendered at build time (make PRERENDERED=ON)
+ *
+ * src/scenes.c is generated by tools/prerender.c, which runs the live
+ * raytracer on the host. Each view is stored the way raytracer_store_row
+ * keeps it in WRAM: a tile map plus its mixed tiles in map order.
+ */
+
+#ifndef _SCENES_H
+#define _SCENES_H
+
+#include <stdint.h>
+#include <gbdk/platform.h>
+#include "raytracer.h"
+
+BANKREF_EXTERN(prerendered_scenes)
+
+extern const uint8_t prerendered_map[NUM_VIEWS][MAX_RENDER_TILES];
+extern const uint16_t prerendered_tile_base[NUM_VIEWS];  /* First tile of each view */
+extern const uint8_t prerendered_tiles[];                /* 16 bytes per mixed tile */
+
+#endif
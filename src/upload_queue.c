@@ -0,0 +1,165 @@
+/**
+ * upload_queue.c - VRAM uploads deferred to the VBlank interrupt
+ *
+ * Single producer (main loop), single consumer (VBlank handler). head and
+ * tail are free-running counters, so a job's ticket is just the tail value
+ * after it was pushed and tickets compare with a signed difference.
+ */
+
+#include <gb/gb.h>
+#include <gb/cgb.h>
+#include "upload_queue.h"
+#include "vram_dma.h"
+#include "profile.h"
+
+#define UPLOAD_QUEUE_MASK   (UPLOAD_QUEUE_SIZE - 1)
+
+#define JOB_TILES       0
+#define JOB_MAP_FILL    1
+#define JOB_SCANLINE    2
+#define JOB_MAP_CELLS   3
+
+#define TILE_DATA       ((uint8_t *)0x8000)
+#define BKG_MAP         ((uint8_t *)0x9800)
+
+typedef struct {
+    uint8_t kind;
+    uint8_t vram_bank;      /* JOB_TILES/SCANLINE: VBK_BANK_0/1 */
+    uint8_t first;          /* JOB_TILES/SCANLINE: first tile, JOB_MAP_FILL: tile value */
+    uint8_t count;          /* Tiles / map cells */
+    uint16_t map_pos;       /* JOB_MAP_FILL/CELLS: y * 32 + x, JOB_SCANLINE: row * 2 */
+    const uint8_t *data;    /* JOB_TILES/SCANLINE/MAP_CELLS: source */
+} upload_job_t;
+
+static upload_job_t upload_jobs[UPLOAD_QUEUE_SIZE];
+static volatile uint8_t upload_head;   /* Jobs run so far */
+static volatile uint8_t upload_tail;   /* Jobs pushed so far */
+
+static void upload_vbl_isr(void) {
+    uint8_t budget = UPLOAD_VBL_TILES;
+    uint8_t saved_vbk = VBK_REG;
+    
+    while (upload_head != upload_tail) {
+        const upload_job_t *job = &upload_jobs[upload_head & UPLOAD_QUEUE_MASK];
+        
+        if (job->kind == JOB_TILES) {
+            if (job->count > budget) break;  /* Next VBlank */
+            budget -= job->count;
+            vram_dma_tiles(job->vram_bank, job->first, job->count, job->data);
+        } else if (job->kind == JOB_SCANLINE) {
+            if (budget < UPLOAD_SCANLINE_COST) break;
+            budget -= UPLOAD_SCANLINE_COST;
+            
+            /* 2 bytes per tile, 16 bytes apart: too short for a DMA block */
+            const uint8_t *src = job->data;
+            uint8_t *dst = TILE_DATA + (uint16_t)job->first * 16 + job->map_pos;
+            VBK_REG = job->vram_bank;
+            for (uint8_t i = 0; i < job->count; i++) {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                src += 16;
+                dst += 16;
+            }
+        } else if (job->kind == JOB_MAP_CELLS) {
+            uint8_t *dst = BKG_MAP + job->map_pos;
+            VBK_REG = VBK_TILES;
+            for (uint8_t i = 0; i < job->count; i++) dst[i] = job->data[i];
+        } else {
+            uint8_t *dst = BKG_MAP + job->map_pos;
+            VBK_REG = VBK_TILES;
+            for (uint8_t i = 0; i < job->count; i++) dst[i] = job->first;
+        }
+        upload_head++;
+    }
+    
+    VBK_REG = saved_vbk;
+}
+
+void upload_queue_init(void) {
+    CRITICAL {
+        add_VBL(upload_vbl_isr);
+    }
+}
+
+static uint8_t push_job(const upload_job_t *job) {
+    uint8_t ticket;
+    
+    /* Full: wait for the handler to make room */
+    PROFILE_BEGIN(prof_start);
+    while ((uint8_t)(upload_tail - upload_head) >= UPLOAD_QUEUE_SIZE);
+    PROFILE_END(PROF_WAIT, prof_start);
+    
+    CRITICAL {
+        const upload_job_t *last = &upload_jobs[(upload_tail - 1) & UPLOAD_QUEUE_MASK];
+        
+        if (upload_head != upload_tail && (job->kind == JOB_TILES || job->kind == JOB_MAP_CELLS) &&
+            last->kind == job->kind && last->vram_bank == job->vram_bank && last->first == job->first &&
+            last->count == job->count && last->map_pos == job->map_pos && last->data == job->data) {
+            /* Still pending: it will pick up the newer data */
+        } else {
+            upload_jobs[upload_tail & UPLOAD_QUEUE_MASK] = *job;
+            upload_tail++;
+        }
+        ticket = upload_tail;
+    }
+    return ticket;
+}
+
+uint8_t upload_queue_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data) {
+    upload_job_t job;
+    
+    job.kind = JOB_TILES;
+    job.vram_bank = vram_bank;
+    job.first = first_tile;
+    job.count = nb_tiles;
+    job.map_pos = 0;
+    job.data = data;
+    return push_job(&job);
+}
+
+uint8_t upload_queue_scanline(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, uint8_t row,
+                              const uint8_t *data) {
+    upload_job_t job;
+    
+    job.kind = JOB_SCANLINE;
+    job.vram_bank = vram_bank;
+    job.first = first_tile;
+    job.count = nb_tiles;
+    job.map_pos = (uint16_t)row * 2;
+    job.data = data;
+    return push_job(&job);
+}
+
+uint8_t upload_queue_map_fill(uint8_t x, uint8_t y, uint8_t w, uint8_t tile) {
+    upload_job_t job;
+    
+    job.kind = JOB_MAP_FILL;
+    job.vram_bank = 0;
+    job.first = tile;
+    job.count = w;
+    job.map_pos = (uint16_t)y * 32 + x;
+    job.data = 0;
+    return push_job(&job);
+}
+
+uint8_t upload_queue_map_cells(uint8_t x, uint8_t y, uint8_t w, const uint8_t *cells) {
+    upload_job_t job;
+    
+    job.kind = JOB_MAP_CELLS;
+    job.vram_bank = 0;
+    job.first = 0;
+    job.count = w;
+    job.map_pos = (uint16_t)y * 32 + x;
+    job.data = cells;
+    return push_job(&job);
+}
+
+void upload_queue_wait(uint8_t ticket) {
+    PROFILE_BEGIN(prof_start);
+    while ((int8_t)(upload_head - ticket) < 0);
+    PROFILE_END(PROF_WAIT, prof_start);
+}
+
+void upload_queue_flush(void) {
+    upload_queue_wait(upload_tail);
+}
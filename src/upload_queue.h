@@ -0,0 +1,47 @@
+/**
+ * upload_queue.h - VRAM uploads deferred to the VBlank interrupt
+ *
+ * The main loop queues uploads and keeps working; a VBlank handler drains
+ * the queue within a fixed budget per frame. Queued data must stay valid
+ * (and unchanged, unless newer content is wanted) until its job has run:
+ * each push returns a ticket for upload_queue_wait.
+ */
+
+#ifndef _UPLOAD_QUEUE_H
+#define _UPLOAD_QUEUE_H
+
+#include <stdint.h>
+
+#define UPLOAD_QUEUE_SIZE   8   /* Pending jobs (power of 2) */
+#define UPLOAD_VBL_TILES    36  /* Tiles DMA'd per VBlank (3 tile rows at 96x96) */
+#define UPLOAD_SCANLINE_COST 3  /* Budget taken by a scanline job (CPU writes) */
+
+/* Install the VBlank handler (call once, before the first push) */
+void upload_queue_init(void);
+
+/* Queue a DMA of nb_tiles (at most UPLOAD_VBL_TILES) from 16-byte aligned
+ * data into VRAM bank vram_bank (VBK_BANK_0/1). A push identical to the
+ * last pending job is merged into it. */
+uint8_t upload_queue_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data);
+
+/* Queue the 2 bitplane bytes of one pixel row (0-7) in nb_tiles tiles of
+ * VRAM bank vram_bank, written by the CPU. data points at that row in the
+ * first tile; the source tiles are 16 bytes apart, as in VRAM. */
+uint8_t upload_queue_scanline(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, uint8_t row,
+                              const uint8_t *data);
+
+/* Queue w background map cells at (x, y) set to tile (rows 32-63: the map
+ * at 0x9C00) */
+uint8_t upload_queue_map_fill(uint8_t x, uint8_t y, uint8_t w, uint8_t tile);
+
+/* Queue w background map cells at (x, y) copied from cells. A push
+ * identical to the last pending job is merged into it. */
+uint8_t upload_queue_map_cells(uint8_t x, uint8_t y, uint8_t w, const uint8_t *cells);
+
+/* Wait until the job with this ticket has run */
+void upload_queue_wait(uint8_t ticket);
+
+/* Wait until the queue is empty */
+void upload_queue_flush(void);
+
+#endif
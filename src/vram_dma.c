@@ -0,0 +1,48 @@
+/**
+ * vram_dma.c - CGB DMA (HDMA1-HDMA5) transfers into VRAM tile data
+ */
+
+#include <gb/gb.h>
+#include <gb/cgb.h>
+#include "vram_dma.h"
+
+#define DMA_MAX_TILES   128     /* HDMA5 length field: 1-128 blocks of 16 bytes */
+#define HDMA5_HBLANK    0x80    /* Mode bit: HBlank DMA instead of general-purpose */
+#define HDMA5_DONE      0x80    /* Reads as set once no transfer is active */
+
+static void dma_start(const uint8_t *src, uint16_t dst, uint8_t nb_tiles, uint8_t mode) {
+    HDMA1_REG = (uint8_t)((uint16_t)src >> 8);
+    HDMA2_REG = (uint8_t)(uint16_t)src;
+    HDMA3_REG = (uint8_t)(dst >> 8);
+    HDMA4_REG = (uint8_t)dst;
+    HDMA5_REG = mode | (nb_tiles - 1);
+}
+
+static void dma_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles,
+                      const uint8_t *data, uint8_t mode) {
+    uint16_t dst = 0x8000 + (uint16_t)first_tile * 16;
+    
+    VBK_REG = vram_bank;
+    while (nb_tiles) {
+        uint8_t n = (nb_tiles > DMA_MAX_TILES) ? DMA_MAX_TILES : nb_tiles;
+        
+        dma_start(data, dst, n, mode);
+        if (mode) {
+            while (!(HDMA5_REG & HDMA5_DONE));
+        }
+        
+        data += (uint16_t)n * 16;
+        dst += (uint16_t)n * 16;
+        nb_tiles -= n;
+    }
+}
+
+void vram_dma_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data) {
+    dma_tiles(vram_bank, first_tile, nb_tiles, data, 0);
+}
+
+void vram_hdma_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data) {
+    /* No HBlanks while the LCD is off */
+    dma_tiles(vram_bank, first_tile, nb_tiles, data, (LCDC_REG & LCDCF_ON) ? HDMA5_HBLANK : 0);
+    VBK_REG = VBK_TILES;
+}
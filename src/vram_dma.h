@@ -0,0 +1,23 @@
+/**
+ * vram_dma.h - CGB DMA (HDMA1-HDMA5) transfers into VRAM tile data
+ *
+ * Sources must be 16-byte aligned and in ROM or WRAM; data is copied to
+ * tile data at 0x8000 (VRAM bank 0 unless given) in blocks of one tile.
+ */
+
+#ifndef _VRAM_DMA_H
+#define _VRAM_DMA_H
+
+#include <stdint.h>
+
+/* General-purpose DMA into VRAM bank vram_bank: the CPU halts until the
+ * copy is done (~8 cycles per tile). Call during VBlank or with the LCD
+ * off. */
+void vram_dma_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data);
+
+/* HBlank DMA into VRAM bank vram_bank (VBK_BANK_0/1): one tile per HBlank,
+ * spread over the frame without tearing the line being drawn; returns when
+ * done. Falls back to general-purpose DMA when the LCD is off. */
+void vram_hdma_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data);
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * wram.h - WRAM bank 0 arena and budget
+ *
+ * Bank 0 (0xC000-0xCFFF) holds every static and the stack (see Makefile);
+ * banks 1-7 are the scene store and staging (raytracer.h). Buffers of
+ * phases that never overlap share one static arena, a union member per
+ * phase. The large buffers of the build are added up below, so options
+ * that cannot fit stop at compile time; the ROM link then checks the real
+ * layout against .STACK (see Makefile).
+ */
+
+#ifndef _WRAM_H
+#define _WRAM_H
+
+#include <stdint.h>
+#include "raytracer.h"
+#include "upload_queue.h"
+#include "profile.h"
+#ifdef LINK_CABLE
+#include "link.h"
+#endif
+
+/* Tile rows alternate between two buffers, so a row queued for upload is
+ * not cleared before the VBlank handler has sent it. PROGRESSIVE passes
+ * revisit every row, so there each tile row has its own buffer (the whole
+ * frame). DMA sources must be 16-byte aligned: raytracer_init aligns the
+ * pointers. */
+#define TILE_ROW_SIZE  (RENDER_TILES_X * 16)
+
+#ifdef PROGRESSIVE
+#define TILE_ROW_BUFFERS  RENDER_TILES_Y
+#else
+#define TILE_ROW_BUFFERS  2
+#endif
+
+#define TITLE_ATTR_SIZE  (20 * 18)   /* Attributes of the whole title screen */
+
+/*============================================================================
+ * PHASE ARENA
+ * The title screen is set up before anything is traced (the background
+ * job starts with wait_for_start), so its attribute map shares the room
+ * of the tile rows and scanline scratch that rendering uses from then on.
+ *============================================================================*/
+
+typedef union {
+    /* show_title_screen */
+    uint8_t title_attr[TITLE_ATTR_SIZE];
+    
+    /* Tracing (raytracer.c), from the first scanline on */
+    struct {
+        uint8_t tile_rows[TILE_ROW_BUFFERS * TILE_ROW_SIZE + 15];
+        uint8_t ground_shade[RENDER_WIDTH];
+        uint8_t sample_lut[RENDER_WIDTH + 1];
+        uint8_t sample_level[RENDER_WIDTH + 1];
+    } render;
+} wram_arena_t;
+
+extern wram_arena_t wram_arena;
+
+/*============================================================================
+ * BUDGET
+ * Sizes as the SM83 build lays them out (2-byte pointers, no padding).
+ * Only the large buffers are counted here: the small statics of every
+ * module and the GBDK runtime are left to the link check in the Makefile,
+ * which reads the end of the RAM areas from the linked symbols and wants
+ * WRAM0_STACK_MIN bytes below .STACK (0xD000); it reads the value from
+ * the define below.
+ *============================================================================*/
+
+#define WRAM0_SIZE        0x1000
+#define WRAM0_OAM         160       /* GBDK's shadow OAM at 0xC000 */
+#define WRAM0_STACK_MIN   256       /* Deepest call chain plus nested interrupt frames */
+
+#define WRAM0_RENDER_SIZE  (TILE_ROW_BUFFERS * TILE_ROW_SIZE + 15 + 3 * RENDER_WIDTH + 2)
+#define WRAM0_ARENA_SIZE   (WRAM0_RENDER_SIZE > TITLE_ATTR_SIZE ? WRAM0_RENDER_SIZE : TITLE_ATTR_SIZE)
+
+/* Tile maps of every view and the current view's tile bins */
+#define WRAM0_SCENE_SIZE   ((NUM_VIEWS + 1) * MAX_RENDER_TILES)
+
+#define WRAM0_UPLOAD_SIZE  (UPLOAD_QUEUE_SIZE * 8)
+
+#ifdef MOVING_LIGHT
+#define WRAM0_DETAIL_SIZE  (NUM_VIEWS * RENDER_TILES_Y * (RENDER_TILES_X > 16 ? 4 : 2))
+#else
+#define WRAM0_DETAIL_SIZE  0
+#endif
+
+#ifdef LINK_CABLE
+#define WRAM0_LINK_SIZE    LINK_ROW_MAX
+#else
+#define WRAM0_LINK_SIZE    0
+#endif
+
+#ifdef PROFILE
+#define WRAM0_PROFILE_SIZE ((NUM_VIEWS + 1) * PROF_PHASES * 4 + NUM_VIEWS * 4)
+#else
+#define WRAM0_PROFILE_SIZE 0
+#endif
+
+#define WRAM0_USED  (WRAM0_OAM + WRAM0_ARENA_SIZE + WRAM0_SCENE_SIZE + WRAM0_UPLOAD_SIZE + \
+                     WRAM0_DETAIL_SIZE + WRAM0_LINK_SIZE + WRAM0_PROFILE_SIZE + WRAM0_STACK_MIN)
+
+#if WRAM0_USED > WRAM0_SIZE
+#error "The buffers of these options leave WRAM bank 0 too little room for the stack; build with fewer of them"
+#endif
+
+#endif
@@ -0,0 +1,701 @@
+/**
+ * bench.c - Host regression gate and benchmark for the raytracer core
+ *
+ * Links the unmodified src/raytracer.c against the host VRAM stand-in in
+ * tools/host (built with HOST_BENCH, so COUNT_OP in the sources tallies
+ * work), renders every view the way render_view does on the Game Boy and
+ * reads the picture back through the tile map and attribute bank bits.
+ * Each view is compared pixel for pixel with a golden image and written
+ * out as an indexed PNG; operation counts and host time are printed per
+ * view. The views are then traced again as background jobs and loaded
+ * (with SRAM_CACHE=ON, first restored from the SRAM cache). Beforehand, a
+ * child process traces them in main()'s boot order from fresh statics.
+ * With LINK_CABLE=ON, the background jobs run src/link.c as the master
+ * against another child running it as the slave, over the serial port in
+ * tools/host/gb.c, and the boot order is timed on that model's clock with
+ * the partner and without.
+ *
+ * Usage: bench GOLDEN_DIR [OUT_DIR]   compare (GOLDEN_DIR "-": skip)
+ * Exit status is 1 if any view differs from its golden image.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <gb/gb.h>
+#include "raytracer.h"
+#include "profile.h"
+#ifdef LINK_CABLE
+#include "link.h"
+#endif
+
+#ifdef DITHER_4X4
+#define DITHER_SUFFIX  "_4x4"
+#else
+#define DITHER_SUFFIX  ""
+#endif
+
+#ifdef MULTI_SPHERE
+#define SCENE_SUFFIX   DITHER_SUFFIX "_multi"
+#else
+#define SCENE_SUFFIX   DITHER_SUFFIX
+#endif
+
+#ifdef FULL_SCREEN
+#define GOLDEN_SUFFIX  SCENE_SUFFIX "_full"
+#else
+#define GOLDEN_SUFFIX  SCENE_SUFFIX
+#endif
+
+uint32_t bench_ops[OP_KINDS];
+
+static const char *const op_names[OP_KINDS] = {
+    "trace_ray", "index LUT", "sphere LUT", "shadow LUT", "multiplies"
+};
+
+/* Raytracer palette from src/graphics.c (RGB8 values) */
+static const uint8_t palette_rgb[4][3] = {
+    { 24, 16, 32 }, { 220, 60, 60 }, { 60, 180, 80 }, { 135, 206, 235 }
+};
+
+static uint8_t pixels[RENDER_HEIGHT][RENDER_WIDTH];   /* Color index 0-3 */
+
+/*============================================================================
+ * RENDER AND READ BACK
+ *============================================================================*/
+
+static void render_view(uint8_t view_id) {
+    raytracer_set_view(view_id);
+    raytracer_load_map(view_id);
+
+    for (uint8_t i = 0; i < RENDER_HEIGHT; i++) {
+#ifdef PROGRESSIVE
+        uint8_t py = raytracer_progressive_scanline(i);
+#else
+        uint8_t py = i;
+#endif
+
+        raytracer_render_scanline(py);
+        raytracer_upload_scanline(py);
+        if ((py & 7) == 7) raytracer_store_row(view_id, py / 8);
+    }
+#ifdef SRAM_CACHE
+    raytracer_cache_view(view_id);
+#endif
+}
+
+/* Decode the render area as the LCD shows it: map entry, attribute bank
+ * bit, then the tile's two bitplanes */
+static void read_screen(void) {
+    for (uint8_t py = 0; py < RENDER_HEIGHT; py++) {
+        for (uint8_t px = 0; px < RENDER_WIDTH; px++) {
+            uint16_t pos = HOST_MAP_OFFSET + ((RENDER_OFFSET_Y + py) / 8) * 32 + (RENDER_OFFSET_X + px) / 8;
+            uint8_t tile = host_vram[0][pos];
+            uint8_t bank = (host_vram[1][pos] & BKGF_BANK1) ? 1 : 0;
+            const uint8_t *row = &host_vram[bank][tile * 16 + (py & 7) * 2];
+            uint8_t bit = 7 - (px & 7);
+
+            pixels[py][px] = ((row[0] >> bit) & 1) | (((row[1] >> bit) & 1) << 1);
+        }
+    }
+}
+
+/*============================================================================
+ * PNG (8-bit indexed, zlib stored blocks: no compressor needed either way)
+ *============================================================================*/
+
+#define PNG_ROW_BYTES  (RENDER_WIDTH + 1)                  /* Filter byte + pixels */
+#define PNG_RAW_BYTES  (RENDER_HEIGHT * PNG_ROW_BYTES)     /* 9312 (full screen: 23184): one stored block */
+
+static uint32_t crc_table[256];
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t n) {
+    if (!crc_table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc_table[i] = c;
+        }
+    }
+    for (size_t i = 0; i < n; i++) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t get_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t n) {
+    uint8_t word[4];
+    uint32_t crc;
+
+    put_be32(word, n);
+    fwrite(word, 1, 4, f);
+    fwrite(type, 1, 4, f);
+    fwrite(data, 1, n, f);
+    crc = crc32_update(0xFFFFFFFFu, (const uint8_t *)type, 4);
+    crc = crc32_update(crc, data, n) ^ 0xFFFFFFFFu;
+    put_be32(word, crc);
+    fwrite(word, 1, 4, f);
+}
+
+static int write_png(const char *path) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static uint8_t idat[2 + 5 + PNG_RAW_BYTES + 4];
+    uint8_t ihdr[13] = { 0 };
+    uint8_t plte[12];
+    uint8_t *raw = &idat[7];
+    uint32_t a = 1, b = 0;
+    FILE *f = fopen(path, "wb");
+
+    if (!f) return 0;
+
+    put_be32(&ihdr[0], RENDER_WIDTH);
+    put_be32(&ihdr[4], RENDER_HEIGHT);
+    ihdr[8] = 8;    /* Bit depth */
+    ihdr[9] = 3;    /* Indexed color */
+    memcpy(plte, palette_rgb, sizeof(plte));
+
+    /* zlib header, one final stored block, Adler-32 */
+    idat[0] = 0x78;
+    idat[1] = 0x01;
+    idat[2] = 0x01;
+    idat[3] = (uint8_t)PNG_RAW_BYTES;
+    idat[4] = (uint8_t)(PNG_RAW_BYTES >> 8);
+    idat[5] = (uint8_t)~PNG_RAW_BYTES;
+    idat[6] = (uint8_t)(~PNG_RAW_BYTES >> 8);
+    for (int y = 0; y < RENDER_HEIGHT; y++) {
+        raw[y * PNG_ROW_BYTES] = 0;
+        memcpy(&raw[y * PNG_ROW_BYTES + 1], pixels[y], RENDER_WIDTH);
+    }
+    for (int i = 0; i < PNG_RAW_BYTES; i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_be32(&raw[PNG_RAW_BYTES], (b << 16) | a);
+
+    fwrite(signature, 1, 8, f);
+    write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+    write_chunk(f, "PLTE", plte, sizeof(plte));
+    write_chunk(f, "IDAT", idat, sizeof(idat));
+    write_chunk(f, "IEND", 0, 0);
+    fclose(f);
+    return 1;
+}
+
+/* Reads back the PNGs write_png makes (render area size, indexed, stored
+ * blocks, filter 0) into golden; returns 0 for anything else */
+static int read_png(const char *path, uint8_t golden[RENDER_HEIGHT][RENDER_WIDTH]) {
+    static uint8_t file[64 * 1024];
+    static uint8_t zdata[sizeof(file)];
+    uint8_t raw[PNG_RAW_BYTES];
+    size_t size, zsize = 0, pos = 8, rawsize = 0;
+    FILE *f = fopen(path, "rb");
+
+    if (!f) return 0;
+    size = fread(file, 1, sizeof(file), f);
+    fclose(f);
+
+    while (pos + 12 <= size) {
+        uint32_t n = get_be32(&file[pos]);
+        const uint8_t *type = &file[pos + 4];
+
+        if (pos + 12 + n > size) return 0;
+        if (!memcmp(type, "IHDR", 4) &&
+            (get_be32(&file[pos + 8]) != RENDER_WIDTH || get_be32(&file[pos + 12]) != RENDER_HEIGHT ||
+             file[pos + 16] != 8 || file[pos + 17] != 3)) {
+            return 0;
+        }
+        if (!memcmp(type, "IDAT", 4)) {
+            memcpy(&zdata[zsize], &file[pos + 8], n);
+            zsize += n;
+        }
+        pos += 12 + n;
+    }
+
+    /* zlib header, then stored blocks only */
+    for (pos = 2; pos + 5 <= zsize;) {
+        uint8_t header = zdata[pos];
+        size_t n = zdata[pos + 1] | ((size_t)zdata[pos + 2] << 8);
+
+        if ((header & 0x06) != 0 || rawsize + n > sizeof(raw) || pos + 5 + n > zsize) return 0;
+        memcpy(&raw[rawsize], &zdata[pos + 5], n);
+        rawsize += n;
+        pos += 5 + n;
+        if (header & 0x01) break;
+    }
+    if (rawsize != PNG_RAW_BYTES) return 0;
+
+    for (int y = 0; y < RENDER_HEIGHT; y++) {
+        if (raw[y * PNG_ROW_BYTES] != 0) return 0;
+        memcpy(golden[y], &raw[y * PNG_ROW_BYTES + 1], RENDER_WIDTH);
+    }
+    return 1;
+}
+
+/*============================================================================
+ * LINK CABLE (LINK_CABLE=ON)
+ * The partner process is serve_link (main.c) on the model's clock: it runs
+ * up to the time of each exchange the master sends, a traced row taking
+ * the clocks tools/host/gb/gb.h estimates for it.
+ *============================================================================*/
+
+#ifdef LINK_CABLE
+
+static pid_t partner_pid;
+static uint8_t partner_tracing;
+static uint8_t partner_view = 0xFF, partner_row;
+static uint32_t partner_time;       /* Where serve_link is */
+static uint32_t partner_done;       /* The traced row is done */
+static uint32_t partner_tx_free;    /* The last reply went out */
+
+static uint32_t ops_total(void) {
+    uint32_t n = 0;
+
+    for (int op = 0; op < OP_KINDS; op++) n += bench_ops[op];
+    return n;
+}
+
+static int read_all(int fd, void *data, size_t n) {
+    uint8_t *p = data;
+
+    while (n) {
+        ssize_t got = read(fd, p, n);
+        if (got <= 0) return 0;
+        p += got;
+        n -= (size_t)got;
+    }
+    return 1;
+}
+
+/* serve_link up to clock t: reply to the row traced once it is done and
+ * the last reply is out, then take the next job */
+static void partner_run(uint32_t t) {
+    while (1) {
+        uint8_t view_id;
+        uint32_t ops, lines = 8;
+
+        if (partner_tracing) {
+            if (t < partner_done || link_replying()) return;
+            link_reply(partner_view, partner_row,
+                       raytracer_pack_row(partner_view, partner_row, link_reply_buffer()));
+            partner_tracing = 0;
+            partner_time = (partner_done > partner_tx_free) ? partner_done : partner_tx_free;
+        } else {
+            partner_time = t;
+        }
+
+        if (!link_job(&view_id, &partner_row)) return;
+
+        /* A new view is selected and classified first */
+        if (view_id != partner_view) lines += RENDER_HEIGHT;
+        partner_view = view_id;
+        ops = ops_total();
+        raytracer_trace_row(partner_view, partner_row);
+        partner_done = partner_time + lines * HOST_LINE_CLOCKS + (ops_total() - ops) * HOST_OP_CLOCKS;
+        partner_tracing = 1;
+    }
+}
+
+static void serve_partner(int fd) {
+    uint8_t msg[5];
+
+    raytracer_init();
+    link_init();
+    set_interrupts(SIO_IFLAG);
+
+    while (read_all(fd, msg, sizeof(msg))) {
+        uint32_t t;
+        uint8_t replying, out;
+
+        memcpy(&t, msg, 4);
+        partner_run(t);
+        replying = link_replying();
+        out = host_link_answer(msg[4]);
+        if (partner_tracing) partner_done += HOST_ISR_CLOCKS;
+        if (replying && !link_replying()) partner_tx_free = t;
+        if (write(fd, &out, 1) != 1) break;
+        partner_run(t);
+    }
+    _exit(0);
+}
+
+/* The second unit, from a fresh raytracer_init (so before this process
+ * touches the raytracer): returns the master's end of the cable, -1 if
+ * the child could not be started */
+static int start_partner(void) {
+    int fd[2];
+
+    fflush(stdout);
+    fflush(stderr);
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) != 0 || (partner_pid = fork()) < 0) {
+        perror("bench: partner");
+        return -1;
+    }
+    if (partner_pid == 0) {
+        close(fd[0]);
+        serve_partner(fd[1]);
+    }
+    close(fd[1]);
+    return fd[0];
+}
+
+static void stop_partner(void) {
+    if (host_link_fd < 0) return;
+    close(host_link_fd);
+    host_link_fd = -1;
+    waitpid(partner_pid, 0, 0);
+}
+
+#endif
+
+/*============================================================================
+ * BACKGROUND RENDERING
+ *============================================================================*/
+
+/* One background job; with LINK_CABLE each step runs for its estimated
+ * clocks on the model's clock, the link's handlers in between */
+static void background_job(uint8_t view_id) {
+#ifdef LINK_CABLE
+    uint8_t more = 1;
+
+    raytracer_background_begin(view_id);
+    while (more) {
+        uint32_t ops = ops_total();
+
+        more = raytracer_background_step();
+        host_run(HOST_LINE_CLOCKS + (ops_total() - ops) * HOST_OP_CLOCKS);
+    }
+#else
+    raytracer_background_begin(view_id);
+    while (raytracer_background_step()) {
+    }
+#endif
+}
+
+static int compare_golden(const char *golden_dir, uint8_t view_id, const char *what) {
+    static uint8_t golden[RENDER_HEIGHT][RENDER_WIDTH];
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/view%u%s.png", golden_dir, view_id, GOLDEN_SUFFIX);
+    if (!read_png(path, golden)) {
+        fprintf(stderr, "bench: cannot read %s\n", path);
+        return 0;
+    }
+    if (memcmp(pixels, golden, sizeof(pixels)) != 0) {
+        fprintf(stderr, "bench: %s differs from %s\n", what, path);
+        return 0;
+    }
+    return 1;
+}
+
+/* The views main() traces in the background, a scanline at a time with the
+ * front view on screen, must leave the screen alone and then load as their
+ * goldens */
+static int check_background(const char *golden_dir) {
+    int ok = 1;
+
+    raytracer_load_scene(VIEW_FRONT);
+    for (uint8_t v = VIEW_FRONT + 1; v < NUM_VIEWS; v++) background_job(v);
+    read_screen();
+    ok &= compare_golden(golden_dir, VIEW_FRONT, "screen during background render");
+
+    for (uint8_t v = VIEW_FRONT + 1; v < NUM_VIEWS; v++) {
+        raytracer_load_scene(v);
+        read_screen();
+        ok &= compare_golden(golden_dir, v, "background rendered view");
+    }
+    return ok;
+}
+
+/* main()'s boot order, from statics nothing has touched yet (so in a child
+ * process): the title screen traces the views before raytracer_init_vram,
+ * and nothing selects a view for the first job. With PROGRESSIVE the front
+ * view is rendered on screen first instead, the others in the background.
+ * With LINK_CABLE, as the master with a fresh partner or none; prints the
+ * model's clock once the background jobs are done. */
+static int check_boot(const char *golden_dir, int with_partner) {
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (pid < 0) {
+        perror("bench: fork");
+        return 0;
+    }
+
+    if (pid == 0) {
+        uint8_t first = VIEW_FRONT;
+        int ok = 1;
+
+#ifdef LINK_CABLE
+        host_link_fd = with_partner ? start_partner() : -1;
+        raytracer_init();
+        link_init();
+        link_start_master();
+#else
+        (void)with_partner;
+        raytracer_init();
+#endif
+#ifdef SRAM_CACHE
+        raytracer_cache_restore();
+#endif
+#ifdef PROGRESSIVE
+        raytracer_init_vram();
+        render_view(VIEW_FRONT);
+        first = VIEW_FRONT + 1;
+#endif
+        for (uint8_t v = first; v < NUM_VIEWS; v++) background_job(v);
+#ifdef LINK_CABLE
+        printf("link   %-7s: views %u-%u in %lu frames, %lu link bytes\n", with_partner ? "partner" : "alone",
+               first, NUM_VIEWS - 1, (unsigned long)(host_clocks / HOST_FRAME_CLOCKS),
+               (unsigned long)host_link_bytes);
+        stop_partner();
+#endif
+#ifndef PROGRESSIVE
+        raytracer_init_vram();
+#endif
+
+        for (uint8_t v = VIEW_FRONT; v < NUM_VIEWS; v++) {
+            raytracer_load_scene(v);
+            read_screen();
+            ok &= compare_golden(golden_dir, v, "view traced at boot");
+        }
+        fflush(stdout);
+        fflush(stderr);
+        _exit(ok ? 0 : 1);
+    }
+
+    if (waitpid(pid, &status, 0) != pid) return 0;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*============================================================================
+ * SRAM CACHE (SRAM_CACHE=ON)
+ *============================================================================*/
+
+#ifdef SRAM_CACHE
+
+/* A warm boot: with the WRAM store wiped, every view must come back from
+ * SRAM and load as its golden; a cache of another build must be dropped */
+static int check_sram_cache(const char *golden_dir) {
+    int ok = 1;
+
+    memset(host_wramx, 0x5A, sizeof(host_wramx));
+    if (raytracer_cache_restore() != (1 << NUM_VIEWS) - 1) {
+        fprintf(stderr, "bench: not every view came back from SRAM\n");
+        return 0;
+    }
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        raytracer_load_scene(v);
+        read_screen();
+        ok &= compare_golden(golden_dir, v, "view from SRAM");
+    }
+
+    host_sram[2] ^= 0xFF;   /* Version */
+    if (raytracer_cache_restore() != 0) {
+        fprintf(stderr, "bench: a cache of another build was used\n");
+        ok = 0;
+    }
+    return ok;
+}
+
+#endif
+
+/*============================================================================
+ * MOVING LIGHT (MOVING_LIGHT=ON)
+ *============================================================================*/
+
+#ifdef MOVING_LIGHT
+
+/* Slide the light of view_id one step at a time to light_x; prints the
+ * average work per step */
+static void slide_light(uint8_t view_id, int16_t light_x) {
+    int16_t lx = raytracer_light_x(view_id);
+    uint16_t steps = 0;
+
+    memset(bench_ops, 0, sizeof(bench_ops));
+    while (lx != light_x) {
+        lx += (lx < light_x) ? LIGHT_MOVE_STEP : -LIGHT_MOVE_STEP;
+        raytracer_move_light(view_id, lx, raytracer_light_z(view_id));
+        steps++;
+    }
+
+    printf("light  view %u: %u steps, per step", view_id, steps);
+    for (int op = 0; op < OP_KINDS; op++) printf(" %lu", (unsigned long)(bench_ops[op] / steps));
+    printf("\n");
+}
+
+#ifdef LIGHT_SWEEP
+/* Turn the light of view_id by step until it reaches angle */
+static void sweep_to(uint8_t view_id, uint8_t angle, int8_t step) {
+    uint16_t steps = 0;
+
+    memset(bench_ops, 0, sizeof(bench_ops));
+    while (raytracer_light_angle(view_id) != angle) {
+        raytracer_sweep_light(view_id, raytracer_light_angle(view_id) + step);
+        steps++;
+    }
+
+    printf("sweep  view %u: %u steps, per step", view_id, steps);
+    for (int op = 0; op < OP_KINDS; op++) printf(" %lu", (unsigned long)(bench_ops[op] / steps));
+    printf("\n");
+}
+#endif
+
+/* Each near/far view's light slid over to the other side must give the
+ * view baked with that light, and sliding it back the original; the
+ * stored scene must follow */
+static int check_moving_light(const char *golden_dir) {
+    static const uint8_t other_side[2] = { VIEW_FRONT_RIGHT, VIEW_BACK_RIGHT };
+    int ok = 1;
+
+    for (uint8_t v = 0; v < 2; v++) {
+        int16_t home = raytracer_light_x(v);
+        
+        raytracer_load_scene(v);
+        slide_light(v, raytracer_light_x(other_side[v]));
+        read_screen();
+        ok &= compare_golden(golden_dir, other_side[v], "moved light");
+        
+        slide_light(v, home);
+        read_screen();
+        ok &= compare_golden(golden_dir, v, "light moved back");
+        
+        /* Push the view out of both VRAM banks, then unpack it */
+        raytracer_load_scene(VIEW_FRONT_RIGHT);
+        raytracer_load_scene(VIEW_BACK_RIGHT);
+        raytracer_load_scene(v);
+        read_screen();
+        ok &= compare_golden(golden_dir, v, "stored relit view");
+
+#ifdef LIGHT_SWEEP
+        /* At angle 192 the light sits exactly where the *_RIGHT views bake
+         * it; the way there passes through every light z */
+        sweep_to(v, 192, -SWEEP_STEP);
+        read_screen();
+        ok &= compare_golden(golden_dir, other_side[v], "light swept to 192");
+
+        sweep_to(v, 0, SWEEP_STEP);
+        read_screen();
+        ok &= compare_golden(golden_dir, v, "light swept back to 0");
+#endif
+    }
+    return ok;
+}
+
+#endif
+
+/*============================================================================
+ * MAIN
+ *============================================================================*/
+
+int main(int argc, char **argv) {
+    static uint8_t golden[RENDER_HEIGHT][RENDER_WIDTH];
+    const char *golden_dir = (argc > 1) ? argv[1] : "-";
+    const char *out_dir = (argc > 2) ? argv[2] : 0;
+    int failed = 0;
+    char path[512];
+
+    /* Before this process touches the raytracer */
+#ifdef LINK_CABLE
+    if ((host_link_fd = start_partner()) < 0) failed = 1;
+#endif
+    if (strcmp(golden_dir, "-") != 0 && !check_boot(golden_dir, 1)) failed = 1;
+#ifdef LINK_CABLE
+    if (strcmp(golden_dir, "-") != 0 && !check_boot(golden_dir, 0)) failed = 1;
+#endif
+
+    raytracer_init_vram();
+    raytracer_init();
+#ifdef LINK_CABLE
+    link_init();
+    link_start_master();
+#endif
+#ifdef SRAM_CACHE
+    raytracer_cache_restore();   /* Blank SRAM: sets up an empty cache */
+#endif
+
+    printf("%-6s %8s", "view", "host us");
+    for (int op = 0; op < OP_KINDS; op++) printf(" %11s", op_names[op]);
+    printf("\n");
+
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        clock_t start = clock();
+
+        memset(bench_ops, 0, sizeof(bench_ops));
+        render_view(v);
+        long us = (long)((clock() - start) * 1000000 / CLOCKS_PER_SEC);
+
+        printf("%-6u %8ld", v, us);
+        for (int op = 0; op < OP_KINDS; op++) printf(" %11lu", (unsigned long)bench_ops[op]);
+        printf("\n");
+
+        read_screen();
+
+        if (out_dir) {
+            snprintf(path, sizeof(path), "%s/view%u%s.png", out_dir, v, GOLDEN_SUFFIX);
+            if (!write_png(path)) {
+                fprintf(stderr, "bench: cannot write %s\n", path);
+                failed = 1;
+            }
+        }
+
+        if (strcmp(golden_dir, "-") != 0) {
+            snprintf(path, sizeof(path), "%s/view%u%s.png", golden_dir, v, GOLDEN_SUFFIX);
+            if (!read_png(path, golden)) {
+                fprintf(stderr, "bench: cannot read %s\n", path);
+                failed = 1;
+                continue;
+            }
+
+            uint16_t diff = 0;
+            for (int y = 0; y < RENDER_HEIGHT; y++) {
+                for (int x = 0; x < RENDER_WIDTH; x++) diff += pixels[y][x] != golden[y][x];
+            }
+            if (diff) {
+                fprintf(stderr, "bench: view %u differs from %s in %u pixels\n", v, path, diff);
+                failed = 1;
+            }
+        }
+    }
+
+    /* Switching back to a scene must show the same picture */
+    for (uint8_t v = 0; v < NUM_VIEWS && strcmp(golden_dir, "-") != 0; v++) {
+        raytracer_load_scene(v);
+        read_screen();
+        snprintf(path, sizeof(path), "%s/view%u%s.png", golden_dir, v, GOLDEN_SUFFIX);
+        if (read_png(path, golden) && memcmp(pixels, golden, sizeof(pixels)) != 0) {
+            fprintf(stderr, "bench: stored view %u differs from %s\n", v, path);
+            failed = 1;
+        }
+    }
+
+#ifdef SRAM_CACHE
+    if (strcmp(golden_dir, "-") != 0 && !check_sram_cache(golden_dir)) failed = 1;
+#endif
+    if (strcmp(golden_dir, "-") != 0 && !check_background(golden_dir)) failed = 1;
+
+#ifdef MOVING_LIGHT
+    if (strcmp(golden_dir, "-") != 0 && !check_moving_light(golden_dir)) failed = 1;
+#endif
+
+#ifdef LINK_CABLE
+    stop_partner();
+#endif
+    printf(failed ? "bench: FAILED\n" : "bench: OK\n");
+    return failed;
+}
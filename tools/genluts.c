@@ -0,0 +1,347 @@
+/**
+ * genluts.c - Host-side generator for the raytracer lookup tables
+ *
+ * Runs on the build machine and prints src/luts.c: every table the
+ * raytracer used to build in raytracer_init/raytracer_set_view, as const
+ * data in ROM bank 1. All divisions happen here instead of on the SM83.
+ *
+ * Usage: genluts > src/luts.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "luts.h"
+
+/*============================================================================
+ * TABLES (same layout as the ROM data)
+ *============================================================================*/
+
+static scanline_luts_t scanlines[RENDER_HEIGHT];
+
+/* Host only: the sphere LUT fold and the ground rows are built from them */
+static int16_t dx_fp[RENDER_WIDTH];
+static int32_t dx_sq[RENDER_WIDTH];
+static int16_t dy_fp[RENDER_HEIGHT];
+static int32_t dy_sq[RENDER_HEIGHT];
+
+static uint8_t lut_fold[LUT_FOLD_ROWS][LUT_FOLD_SIZE];
+
+static uint8_t shadow_lut[SHADOW_LUT_SIZE];
+
+static view_luts_t views[NUM_VIEWS];
+
+/*============================================================================
+ * VIEW-INDEPENDENT TABLES
+ *============================================================================*/
+
+static void init_shadow_lut(void) {
+    /* Shadow parameters (matching trace_ray calculations) */
+    int16_t shadow_radius_sq = (int16_t)(SPHERE_R_SQ << FX8_SHIFT);      /* 1024 */
+    int16_t umbra_radius_sq = shadow_radius_sq >> 2;                     /* 256 */
+    int16_t penumbra_range = shadow_radius_sq - umbra_radius_sq;         /* 768 */
+
+    /* Build LUT: map shadow_dist_sq to brightness (0-255) */
+    for (int i = 0; i < SHADOW_LUT_SIZE; i++) {
+        /* shadow_dist_sq value for this LUT entry */
+        int16_t dist_sq = (int16_t)((int32_t)i << SHADOW_LUT_SHIFT);
+
+        if (dist_sq >= shadow_radius_sq) {
+            /* Outside shadow */
+            shadow_lut[i] = 255;
+        } else if (dist_sq <= umbra_radius_sq) {
+            /* Full shadow (umbra) */
+            shadow_lut[i] = 0;
+        } else {
+            /* Penumbra (soft edge) - linear interpolation */
+            int16_t dist_in_penumbra = dist_sq - umbra_radius_sq;
+            shadow_lut[i] = (uint8_t)(((int32_t)dist_in_penumbra * 256) / penumbra_range);
+        }
+    }
+}
+
+static void init_dx_dy_arrays(void) {
+    int16_t half_w = RENDER_WIDTH / 2;
+    int16_t half_h = RENDER_HEIGHT / 2;
+
+    for (int x = 0; x < RENDER_WIDTH; x++) {
+        int16_t dx = ((int16_t)x - half_w) * RAY_STEP_FP;
+        dx_fp[x] = dx;
+        dx_sq[x] = (int32_t)dx * dx;
+    }
+
+    for (int y = 0; y < RENDER_HEIGHT; y++) {
+        int16_t dy = (half_h - (int16_t)y) * RAY_STEP_FP;
+        dy_fp[y] = dy;
+        dy_sq[y] = (int32_t)dy * dy;
+    }
+}
+
+/* Same quantization as the sphere intersection LUTs below */
+static uint8_t sphere_lut_index(int32_t dx_sq_px, int32_t dy_sq_py) {
+    int16_t d_dot_d = (int16_t)((dx_sq_px + dy_sq_py + DZ_SQ_CONSTANT) >> FX8_SHIFT);
+    
+    if (d_dot_d < LUT_MIN_VAL) d_dot_d = LUT_MIN_VAL;
+    if (d_dot_d > LUT_MAX_VAL) d_dot_d = LUT_MAX_VAL;
+    
+    uint8_t lut_index = (uint8_t)((d_dot_d - LUT_MIN_VAL) >> LUT_SHIFT);
+    if (lut_index >= LUT_SIZE) lut_index = LUT_SIZE - 1;
+    return lut_index;
+}
+
+/* dx and dy are symmetric around the screen center: column W/2 - ax and
+ * row H/2 - ay stand for all four quadrants */
+static void init_lut_fold(void) {
+    for (int ay = 0; ay < LUT_FOLD_ROWS; ay++) {
+        for (int ax = 0; ax < LUT_FOLD_SIZE; ax++) {
+            lut_fold[ay][ax] = sphere_lut_index(dx_sq[RENDER_WIDTH / 2 - ax], dy_sq[RENDER_HEIGHT / 2 - ay]);
+        }
+    }
+}
+
+static void init_ground_scanlines(void) {
+    for (int py = 0; py < RENDER_HEIGHT; py++) {
+        scanline_luts_t *s = &scanlines[py];
+        int16_t dy = dy_fp[py];
+
+        s->t_ground = SCANLINE_NO_GROUND;
+        if (dy < -16) {
+            /* t_ground = (-CAM_Y << (FX8_SHIFT + FX8_SHIFT)) / dy_fp */
+            int16_t t = (int16_t)(-((int32_t)CAM_Y << (FX8_SHIFT + FX8_SHIFT)) / dy);
+
+            if (t > 16 && t < 2000) {
+                s->hit_ground = 1;
+                s->t_ground = t;
+                /* dx_fp * t_ground steps by a constant along the row */
+                s->ground_step = RAY_STEP_FP * t;
+                s->ground_frac0 = (uint8_t)((int32_t)dx_fp[0] * t);
+                s->ground_x0 = (int16_t)(((int32_t)dx_fp[0] * t) >> FX8_SHIFT);
+                s->px_per_x = (int16_t)(((int32_t)1 << 24) / s->ground_step);
+            }
+        }
+    }
+}
+
+/*============================================================================
+ * PER-VIEW TABLES
+ *============================================================================*/
+
+/* Ray of LUT entry lut_index passes within SPHERE_R of the center */
+static int lut_entry_hits(const object_luts_t *o, uint8_t lut_index) {
+    int32_t dist_sq_fp = (((int32_t)o->cz * o->cz) << FX8_SHIFT) - o->lut_proj_sq[lut_index];
+    return dist_sq_fp < ((int32_t)SPHERE_R_SQ << FX8_SHIFT) && o->oc_dot_d > 0;
+}
+
+/* Same test as sphere_hit_test in src/raytracer.c */
+static int object_hit(const object_luts_t *o, uint8_t lut_index) {
+    return lut_index < o->lut_hit_end;
+}
+
+static void init_object(object_luts_t *o, int16_t cx, int16_t cz) {
+    o->cx = (int16_t)(cx << FX8_SHIFT);
+    o->cz = cz;
+
+    /* Column the center projects to: cx / cz over RAY_STEP_FP per pixel */
+    int32_t num = (int32_t)cx << FX8_SHIFT;
+    int32_t den = (int32_t)cz * RAY_STEP_FP;
+    o->shift = (int8_t)((num + ((num < 0) ? -den / 2 : den / 2)) / den);
+
+    /* oc_dot_d depends on the depth only */
+    o->oc_dot_d = FX8_MUL(cz << FX8_SHIFT, FX8_ONE);
+
+    /* Quantized LUTs for sphere intersection divisions */
+    for (int i = 0; i < LUT_SIZE; i++) {
+        /* d_dot_d value for this LUT entry (center of quantized range) */
+        int32_t d_dot_d = LUT_MIN_VAL + ((int32_t)i << LUT_SHIFT) + (1 << (LUT_SHIFT - 1));
+
+        o->lut_t_hit[i] = (int16_t)(((int32_t)o->oc_dot_d << FX8_SHIFT) / d_dot_d);
+        o->lut_proj_sq[i] = (int16_t)(((int32_t)o->oc_dot_d * o->oc_dot_d) / d_dot_d);
+    }
+
+    /* proj_sq only falls as d_dot_d grows, so the entries that hit come
+     * first */
+    o->lut_hit_end = 0;
+    while (o->lut_hit_end < LUT_SIZE && lut_entry_hits(o, o->lut_hit_end)) o->lut_hit_end++;
+    for (int i = o->lut_hit_end; i < LUT_SIZE; i++) {
+        if (lut_entry_hits(o, (uint8_t)i)) {
+            fprintf(stderr, "genluts: sphere at depth %d: LUT entry %d hits past a miss\n", cz, i);
+            exit(1);
+        }
+    }
+
+    /* Tiles of every pixel the moved image hits */
+    o->tile_x0 = o->tile_y0 = RENDER_TILES_X;
+    o->tile_x1 = o->tile_y1 = 0;
+    for (int py = 0; py < RENDER_HEIGHT; py++) {
+        int ay = (py < RENDER_HEIGHT / 2) ? RENDER_HEIGHT / 2 - py : py - RENDER_HEIGHT / 2;
+
+        for (int px = 0; px < RENDER_WIDTH; px++) {
+            int local = px - o->shift;
+            if (local < 0 || local > RENDER_WIDTH) continue;
+
+            int ax = (local < RENDER_WIDTH / 2) ? RENDER_WIDTH / 2 - local : local - RENDER_WIDTH / 2;
+            if (!object_hit(o, lut_fold[ay][ax])) continue;
+
+            if (px / 8 < o->tile_x0) o->tile_x0 = px / 8;
+            if (px / 8 > o->tile_x1) o->tile_x1 = px / 8;
+            if (py / 8 < o->tile_y0) o->tile_y0 = py / 8;
+            if (py / 8 > o->tile_y1) o->tile_y1 = py / 8;
+        }
+    }
+    if (o->tile_y0 > o->tile_y1) o->tile_y0 = 1;
+}
+
+static void init_view(view_luts_t *v, int16_t sphere_cz, int8_t light_dir_x, int8_t light_dir_z) {
+    static const int8_t objects[NUM_OBJECTS][2] = SCENE_OBJECTS;
+    int32_t dist_sq[NUM_OBJECTS];
+
+    v->sphere_cz = sphere_cz;
+    v->light_dir_x = light_dir_x;
+    v->light_dir_z = light_dir_z;
+
+    /* Far to near: for spheres of one radius that do not intersect, drawing
+     * them in order of center distance resolves every overlap */
+    for (int n = 0; n < NUM_OBJECTS; n++) {
+        int16_t cx = SPHERE_CX + objects[n][0];
+        int16_t cz = sphere_cz + objects[n][1];
+        int32_t d = (int32_t)cx * cx + (int32_t)cz * cz;
+        int i = n;
+
+        while (i > 0 && dist_sq[i - 1] < d) {
+            v->objects[i] = v->objects[i - 1];
+            dist_sq[i] = dist_sq[i - 1];
+            i--;
+        }
+        init_object(&v->objects[i], cx, cz);
+        dist_sq[i] = d;
+    }
+}
+
+/*============================================================================
+ * SCENE HASH (for the SRAM_CACHE build)
+ *============================================================================*/
+
+/* FNV-1a, 32 bits */
+static uint32_t hash_bytes(uint32_t h, const void *data, size_t n) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+/* Everything a rendered view depends on but the dither pattern (see
+ * SCENE_CACHE_VERSION): the scene constants and every table the tracer
+ * reads */
+static uint32_t hash_scene(void) {
+    static const int16_t params[NUM_VIEWS][3] = VIEW_PARAMS;
+    static const int8_t objects[NUM_OBJECTS][2] = SCENE_OBJECTS;
+    static const int16_t constants[] = {
+        SPHERE_CX, SPHERE_CY, SPHERE_CZ, SPHERE_R, SPHERE_R_SQ,
+        LIGHT_X, LIGHT_Y, LIGHT_Z, RENDER_WIDTH, RENDER_HEIGHT
+    };
+    uint32_t h = 2166136261u;
+
+    h = hash_bytes(h, constants, sizeof(constants));
+    h = hash_bytes(h, params, sizeof(params));
+    h = hash_bytes(h, objects, sizeof(objects));
+    h = hash_bytes(h, scanlines, sizeof(scanlines));
+    h = hash_bytes(h, lut_fold, sizeof(lut_fold));
+    h = hash_bytes(h, shadow_lut, sizeof(shadow_lut));
+    return hash_bytes(h, views, sizeof(views));
+}
+
+/*============================================================================
+ * OUTPUT
+ *============================================================================*/
+
+static void print_i16(const char *indent, const int16_t *a, int n) {
+    for (int i = 0; i < n; i++) {
+        printf("%s%6d%s", (i % 12) ? " " : indent, a[i], (i + 1 < n) ? "," : "");
+        if (i % 12 == 11 || i + 1 == n) printf("\n");
+    }
+}
+
+/* { t_ground, ground_step, ground_x0, px_per_x, ground_frac0, hit_ground } */
+static void print_scanlines(const char *indent, const scanline_luts_t *a, int n) {
+    for (int i = 0; i < n; i++) {
+        printf("%s{ %5d, %5d, %5d, %5d, %3u, %u }%s\n", indent, a[i].t_ground, a[i].ground_step,
+               a[i].ground_x0, a[i].px_per_x, a[i].ground_frac0, a[i].hit_ground, (i + 1 < n) ? "," : "");
+    }
+}
+
+static void print_u8(const char *indent, const uint8_t *a, int n) {
+    for (int i = 0; i < n; i++) {
+        printf("%s%3u%s", (i % 16) ? " " : indent, a[i], (i + 1 < n) ? "," : "");
+        if (i % 16 == 15 || i + 1 == n) printf("\n");
+    }
+}
+
+#define PRINT_TABLE(type, name, printer, data, n) do { \
+    printf("const %s %s[%d] = {\n", type, name, n); \
+    printer("    ", data, n); \
+    printf("};\n\n"); \
+} while (0)
+
+#define PRINT_FIELD(name, printer, data, n) do { \
+    printf("                ." name " = {\n"); \
+    printer("                    ", data, n); \
+    printf("                }%s\n", ","); \
+} while (0)
+
+int main(void) {
+    static const int16_t params[NUM_VIEWS][3] = VIEW_PARAMS;
+
+    init_shadow_lut();
+    init_dx_dy_arrays();
+    init_lut_fold();
+    init_ground_scanlines();
+    for (int v = 0; v < NUM_VIEWS; v++) {
+        init_view(&views[v], params[v][0], (int8_t)params[v][1], (int8_t)params[v][2]);
+    }
+
+    printf("//AUTOGENERATED FILE FROM tools/genluts.c\n\n");
+    printf("#pragma bank 1\n\n");
+    printf("#include <stdint.h>\n");
+    printf("#include <gbdk/platform.h>\n");
+    printf("#include \"luts.h\"\n\n");
+    printf("BANKREF(raytracer_luts)\n\n");
+
+    PRINT_TABLE("scanline_luts_t", "scanline_luts", print_scanlines, scanlines, RENDER_HEIGHT);
+    printf("const uint8_t sphere_lut_fold[LUT_FOLD_ROWS][LUT_FOLD_SIZE] = {\n");
+    for (int ay = 0; ay < LUT_FOLD_ROWS; ay++) {
+        printf("    {\n");
+        print_u8("        ", lut_fold[ay], LUT_FOLD_SIZE);
+        printf("    }%s\n", (ay + 1 < LUT_FOLD_ROWS) ? "," : "");
+    }
+    printf("};\n\n");
+    PRINT_TABLE("uint8_t", "shadow_brightness_lut", print_u8, shadow_lut, SHADOW_LUT_SIZE);
+
+    printf("const view_luts_t view_luts[NUM_VIEWS] = {\n");
+    for (int v = 0; v < NUM_VIEWS; v++) {
+        const view_luts_t *l = &views[v];
+        printf("    {\n");
+        printf("        .sphere_cz = %d,\n", l->sphere_cz);
+        printf("        .light_dir_x = %d,\n", l->light_dir_x);
+        printf("        .light_dir_z = %d,\n", l->light_dir_z);
+        printf("        .objects = {\n");
+        for (int n = 0; n < NUM_OBJECTS; n++) {
+            const object_luts_t *o = &l->objects[n];
+            printf("            {\n");
+            printf("                .cx = %d,\n", o->cx);
+            printf("                .cz = %d,\n", o->cz);
+            printf("                .shift = %d,\n", o->shift);
+            printf("                .tile_x0 = %u, .tile_x1 = %u,\n", o->tile_x0, o->tile_x1);
+            printf("                .tile_y0 = %u, .tile_y1 = %u,\n", o->tile_y0, o->tile_y1);
+            printf("                .oc_dot_d = %d,\n", o->oc_dot_d);
+            printf("                .lut_hit_end = %u,\n", o->lut_hit_end);
+            PRINT_FIELD("lut_t_hit", print_i16, o->lut_t_hit, LUT_SIZE);
+            PRINT_FIELD("lut_proj_sq", print_i16, o->lut_proj_sq, LUT_SIZE);
+            printf("            }%s\n", (n + 1 < NUM_OBJECTS) ? "," : "");
+        }
+        printf("        }\n");
+        printf("    }%s\n", (v + 1 < NUM_VIEWS) ? "," : "");
+    }
+    printf("};\n\n");
+    printf("const uint32_t scene_hash = 0x%08lXUL;\n", (unsigned long)hash_scene());
+
+    return 0;
+}
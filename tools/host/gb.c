@@ -0,0 +1,187 @@
+/**
+ * gb.c - Host implementation of the VRAM calls in tools/host/gb/gb.h
+ *
+ * Also replaces src/vram_dma.c and src/upload_queue.c: DMA transfers
+ * become plain copies and queued uploads run immediately. With LINK_CABLE
+ * it is the serial port src/link.c drives: the master's exchanges go to
+ * the partner process over host_link_fd, and host_run steps a clock of
+ * CPU clocks, firing the serial and VBlank handlers as they fall due.
+ */
+
+#include <string.h>
+#include "gb/gb.h"
+#include "vram_dma.h"
+#include "upload_queue.h"
+#ifdef LINK_CABLE
+#include <unistd.h>
+#endif
+
+uint8_t host_vram[2][0x2000];
+uint8_t VBK_REG;
+uint8_t host_wramx[8][0x1000];
+uint8_t SVBK_REG = 1;
+uint8_t host_sram[0x2000];
+
+void set_bkg_data(uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data) {
+    /* 0 tiles means 256, as on hardware */
+    uint16_t count = nb_tiles ? nb_tiles : 256;
+    memcpy(&host_vram[VBK_REG & 1][first_tile * 16], data, (size_t)count * 16);
+}
+
+void set_bkg_tiles(uint8_t x, uint8_t y, uint8_t w, uint8_t h, const uint8_t *tiles) {
+    for (uint8_t j = 0; j < h; j++) {
+        for (uint8_t i = 0; i < w; i++) {
+            uint16_t pos = ((y + j) & 31) * 32 + ((x + i) & 31);
+            host_vram[VBK_REG & 1][HOST_MAP_OFFSET + pos] = tiles[j * w + i];
+        }
+    }
+}
+
+void wait_vbl_done(void) {
+}
+
+void vram_dma_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data) {
+    uint8_t saved = VBK_REG;
+    
+    VBK_REG = vram_bank;
+    set_bkg_data(first_tile, nb_tiles, data);
+    VBK_REG = saved;
+}
+
+void vram_hdma_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data) {
+    uint8_t saved = VBK_REG;
+    
+    VBK_REG = vram_bank;
+    set_bkg_data(first_tile, nb_tiles, data);
+    VBK_REG = saved;
+}
+
+void upload_queue_init(void) {
+}
+
+uint8_t upload_queue_tiles(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data) {
+    vram_dma_tiles(vram_bank, first_tile, nb_tiles, data);
+    return 0;
+}
+
+uint8_t upload_queue_scanline(uint8_t vram_bank, uint8_t first_tile, uint8_t nb_tiles, uint8_t row,
+                              const uint8_t *data) {
+    for (uint8_t i = 0; i < nb_tiles; i++) {
+        memcpy(&host_vram[vram_bank & 1][(first_tile + i) * 16 + row * 2], &data[i * 16], 2);
+    }
+    return 0;
+}
+
+uint8_t upload_queue_map_fill(uint8_t x, uint8_t y, uint8_t w, uint8_t tile) {
+    uint8_t saved = VBK_REG;
+    
+    VBK_REG = VBK_TILES;
+    for (uint8_t i = 0; i < w; i++) set_bkg_tiles(x + i, y, 1, 1, &tile);
+    VBK_REG = saved;
+    return 0;
+}
+
+uint8_t upload_queue_map_cells(uint8_t x, uint8_t y, uint8_t w, const uint8_t *cells) {
+    uint8_t saved = VBK_REG;
+    
+    VBK_REG = VBK_TILES;
+    set_bkg_tiles(x, y, w, 1, cells);
+    VBK_REG = saved;
+    return 0;
+}
+
+void upload_queue_wait(uint8_t ticket) {
+    (void)ticket;
+}
+
+void upload_queue_flush(void) {
+}
+
+#ifdef LINK_CABLE
+
+uint8_t SB_REG, SC_REG, IE_REG = VBL_IFLAG;
+int host_link_fd = -1;
+uint32_t host_clocks;
+uint32_t host_link_bytes;
+
+static void (*sio_handler)(void);
+static void (*vbl_handler)(void);
+static uint8_t shifting;            /* The master's byte is on the wire */
+static uint32_t shift_done;
+static uint32_t next_vbl = HOST_FRAME_CLOCKS;
+
+void add_SIO(void (*handler)(void)) {
+    sio_handler = handler;
+}
+
+void add_VBL(void (*handler)(void)) {
+    vbl_handler = handler;
+}
+
+void set_interrupts(uint8_t flags) {
+    IE_REG = flags;
+}
+
+/* The partner's byte for out: it is sent the time of the exchange too,
+ * so it can run its main loop up to then */
+static uint8_t exchange(uint8_t out) {
+    uint8_t msg[5];
+    uint8_t in;
+
+    if (host_link_fd < 0) return 0xFF;
+    host_link_bytes++;
+    memcpy(msg, &host_clocks, 4);
+    msg[4] = (host_link_bytes % HOST_LINK_NOISE == HOST_LINK_NOISE / 2) ? out ^ 0x10 : out;
+    if (write(host_link_fd, msg, 5) != 5 || read(host_link_fd, &in, 1) != 1) {
+        host_link_fd = -1;
+        return 0xFF;
+    }
+    return (host_link_bytes % HOST_LINK_NOISE == 0) ? in ^ 0x10 : in;
+}
+
+void host_run(uint32_t clocks) {
+    uint32_t end = host_clocks + clocks;
+
+    while (1) {
+        if (!shifting && (SC_REG & (SIOF_XFER_START | SIOF_CLOCK_INT)) == (SIOF_XFER_START | SIOF_CLOCK_INT)) {
+            shifting = 1;
+            shift_done = host_clocks + HOST_BYTE_CLOCKS;
+        }
+
+        if (shifting && shift_done <= next_vbl && shift_done <= end) {
+            host_clocks = shift_done;
+            shifting = 0;
+            SB_REG = exchange(SB_REG);
+            SC_REG &= ~SIOF_XFER_START;
+            if ((IE_REG & SIO_IFLAG) && sio_handler) {
+                sio_handler();
+                end += HOST_ISR_CLOCKS;
+                host_clocks += HOST_ISR_CLOCKS;
+            }
+        } else if (next_vbl <= end) {
+            host_clocks = next_vbl;
+            next_vbl += HOST_FRAME_CLOCKS;
+            if ((IE_REG & VBL_IFLAG) && vbl_handler) {
+                vbl_handler();
+                end += HOST_ISR_CLOCKS;
+                host_clocks += HOST_ISR_CLOCKS;
+            }
+        } else {
+            break;
+        }
+    }
+    host_clocks = end;
+}
+
+uint8_t host_link_answer(uint8_t in) {
+    uint8_t out = SB_REG;
+
+    SB_REG = in;
+    if ((SC_REG & (SIOF_XFER_START | SIOF_CLOCK_INT)) == SIOF_XFER_START) {
+        SC_REG &= ~SIOF_XFER_START;
+        if ((IE_REG & SIO_IFLAG) && sio_handler) sio_handler();
+    }
+    return out;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * gb.h - Host stand-in for the GBDK headers used by the raytracer
+ *
+ * Lets src/raytracer.c build with a normal C compiler for the tools in
+ * tools/. VRAM is a plain array (2 banks x 8KB, offsets from 0x8000),
+ * ROM banking is a no-op and cartridge SRAM a plain array.
+ */
+
+#ifndef _HOST_GB_H
+#define _HOST_GB_H
+
+#include <stdint.h>
+
+#define BANKREF(x)          const uint8_t __bank_ ## x = 1;
+#define BANKREF_EXTERN(x)   extern const uint8_t __bank_ ## x;
+#define BANK(x)             (__bank_ ## x)
+#define SWITCH_ROM(b)       ((void)(b))
+
+#define VBK_TILES       0
+#define VBK_ATTRIBUTES  1
+#define VBK_BANK_0      0
+#define VBK_BANK_1      1
+
+#define BKGF_BANK1      0x08     /* Attribute: tile data from VRAM bank 1 */
+
+#define HOST_MAP_OFFSET 0x1800   /* 0x9800: background map */
+
+extern uint8_t host_vram[2][0x2000];
+extern uint8_t VBK_REG;
+
+/* CGB WRAM banks 1-7, seen through 0xD000 */
+extern uint8_t host_wramx[8][0x1000];
+extern uint8_t SVBK_REG;
+#define WRAMX_BASE      (host_wramx[SVBK_REG & 7])
+
+/* Cartridge SRAM (one 8KB bank at 0xA000), always enabled */
+extern uint8_t host_sram[0x2000];
+#define SRAM_BASE       (host_sram)
+#define ENABLE_RAM      ((void)0)
+#define DISABLE_RAM     ((void)0)
+#define SWITCH_RAM(b)   ((void)(b))
+
+#ifdef LINK_CABLE
+/* Serial port and interrupts for src/link.c. gb.c shifts bytes through
+ * host_link_fd to the partner process (-1: no cable) on a clock of its own;
+ * handlers run between calls to host_run, which is as if interrupts were
+ * off in the code that calls it. */
+extern uint8_t SB_REG, SC_REG, IE_REG;
+
+#define SIOF_XFER_START  0x80
+#define SIOF_SPEED_32X   0x02
+#define SIOF_CLOCK_INT   0x01
+#define SIOF_CLOCK_EXT   0x00
+#define VBL_IFLAG        0x01
+#define SIO_IFLAG        0x08
+
+#define CRITICAL
+
+void add_SIO(void (*handler)(void));
+void add_VBL(void (*handler)(void));
+void set_interrupts(uint8_t flags);
+
+/* CPU clocks (4.19 MHz) of the model: a byte at the fast serial speed, a
+ * handler, and the costs of traced work, taken as a fixed part per
+ * scanline (filling and packing its pixels) and one per counted operation
+ * (bench_ops). They are estimates, not SM83 timings. */
+#define HOST_FRAME_CLOCKS  70224
+#define HOST_BYTE_CLOCKS   128
+#define HOST_ISR_CLOCKS    400
+#define HOST_LINE_CLOCKS   8000
+#define HOST_OP_CLOCKS     400
+
+/* One byte in HOST_LINK_NOISE each way arrives corrupted */
+#ifndef HOST_LINK_NOISE
+#define HOST_LINK_NOISE    997
+#endif
+
+extern int host_link_fd;
+extern uint32_t host_clocks;        /* Master: clocks run so far */
+extern uint32_t host_link_bytes;    /* Bytes traded so far */
+
+/* Master: run clocks of main code, with the handlers due in between */
+void host_run(uint32_t clocks);
+
+/* Partner: the master's byte shifted in, the one SB held shifted out */
+uint8_t host_link_answer(uint8_t in);
+#endif
+
+void set_bkg_data(uint8_t first_tile, uint8_t nb_tiles, const uint8_t *data);
+void set_bkg_tiles(uint8_t x, uint8_t y, uint8_t w, uint8_t h, const uint8_t *tiles);
+void wait_vbl_done(void);
+
+#endif
@@ -0,0 +1 @@
+#include <gb/gb.h>
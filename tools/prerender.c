@@ -0,0 +1,96 @@
+/**
+ * prerender.c - Renders every view on the host and prints src/scenes.c
+ *
+ * Links the unmodified src/raytracer.c against the host VRAM stand-in in
+ * tools/host, renders each VIEW_* exactly as render_view does on the Game
+ * Boy, and reads the result back out of VRAM: the view's tile map and its
+ * mixed tiles in map order (the layout raytracer_store_row keeps).
+ *
+ * Usage: prerender > src/scenes.c
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <gb/gb.h>
+#include "raytracer.h"
+
+static uint8_t view_map[NUM_VIEWS][MAX_RENDER_TILES];
+static uint8_t tiles[NUM_VIEWS * MAX_RENDER_TILES][16];
+static uint16_t tile_base[NUM_VIEWS];
+static uint16_t tile_count;
+
+static void capture_view(uint8_t view_id) {
+    uint16_t map_base = HOST_MAP_OFFSET + (RENDER_OFFSET_Y / 8) * 32 + RENDER_OFFSET_X / 8;
+
+    tile_base[view_id] = tile_count;
+    for (uint16_t i = 0; i < MAX_RENDER_TILES; i++) {
+        uint16_t pos = map_base + (i / RENDER_TILES_X) * 32 + i % RENDER_TILES_X;
+        uint8_t t = host_vram[0][pos];
+        uint8_t bank = (host_vram[1][pos] & BKGF_BANK1) ? 1 : 0;
+
+        view_map[view_id][i] = t;
+        if (t != RENDER_TILE_SKY && t != RENDER_TILE_GROUND) {
+            for (uint8_t b = 0; b < 16; b++) tiles[tile_count][b] = host_vram[bank][t * 16 + b];
+            tile_count++;
+        }
+    }
+}
+
+static void render_view(uint8_t view_id) {
+    raytracer_set_view(view_id);
+    raytracer_load_map(view_id);
+
+    for (uint8_t py = 0; py < RENDER_HEIGHT; py++) {
+        raytracer_render_scanline(py);
+        if ((py & 7) == 7) raytracer_upload_row(py / 8);
+    }
+}
+
+int main(void) {
+    raytracer_init_vram();
+    raytracer_init();
+
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        render_view(v);
+        capture_view(v);
+    }
+
+    printf("//AUTOGENERATED FILE FROM tools/prerender.c\n\n");
+    printf("#pragma bank 1\n\n");
+    printf("#include <stdint.h>\n");
+    printf("#include <gbdk/platform.h>\n");
+    printf("#include \"scenes.h\"\n\n");
+    printf("BANKREF(prerendered_scenes)\n\n");
+
+    printf("const uint8_t prerendered_map[NUM_VIEWS][MAX_RENDER_TILES] = {\n");
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        printf("    {\n");
+        for (uint16_t i = 0; i < MAX_RENDER_TILES; i++) {
+            printf("%s%3u%s", (i % RENDER_TILES_X) ? " " : "        ", view_map[v][i],
+                   (i + 1 < MAX_RENDER_TILES) ? "," : "");
+            if (i % RENDER_TILES_X == RENDER_TILES_X - 1) printf("\n");
+        }
+        printf("    }%s\n", (v + 1 < NUM_VIEWS) ? "," : "");
+    }
+    printf("};\n\n");
+
+    printf("const uint16_t prerendered_tile_base[NUM_VIEWS] = {");
+    for (uint8_t v = 0; v < NUM_VIEWS; v++) {
+        printf(" %u%s", tile_base[v], (v + 1 < NUM_VIEWS) ? "," : " ");
+    }
+    printf("};\n\n");
+
+    printf("const uint8_t prerendered_tiles[%u] = {\n", tile_count * 16);
+    for (uint16_t t = 0; t < tile_count; t++) {
+        printf("    ");
+        for (uint8_t b = 0; b < 16; b++) {
+            printf("0x%02x%s", tiles[t][b], (t + 1 < tile_count || b < 15) ? "," : "");
+        }
+        printf("\n");
+    }
+    printf("};\n");
+
+    fprintf(stderr, "prerender: %u mixed tiles (%u bytes) for %u views\n",
+            tile_count, tile_count * 16, NUM_VIEWS);
+    return 0;
+}